@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2026  bind-dyndb-ldap authors; see COPYING for license
+ */
+
+#include <isc/mem.h>
+#include <isc/mutex.h>
+#include <isc/util.h>
+
+#include <dns/fixedname.h>
+#include <dns/name.h>
+
+#include <string.h>
+
+#include "dyndb-config.h"
+#include "dn_cache.h"
+#include "str.h"
+#include "util.h"
+
+/**
+ * The DN cache is a bounded LRU map from (owner name, zone name) to
+ * the escaped LDAP DN of the owner and offset of the zone DN inside it.
+ *
+ * It is used on the write path so repeated updates of the same names do not
+ * have to go through dns_name_tostring() + DN escaping and then back through
+ * DN parsing again. Entries for a zone have to be flushed whenever the zone
+ * is added to or removed from the zone register because the zone DN
+ * might change.
+ */
+typedef struct dn_cache_entry dn_cache_entry_t;
+typedef ISC_LIST(dn_cache_entry_t) dn_cache_list_t;
+
+struct dn_cache_entry {
+	dns_fixedname_t			owner;
+	dns_fixedname_t			zone;
+	char				*dn;
+	size_t				zone_dn_offset;
+	unsigned int			hashval;
+	ISC_LINK(dn_cache_entry_t)	lru_link;
+	ISC_LINK(dn_cache_entry_t)	hash_link;
+};
+
+struct dn_cache {
+	isc_mem_t		*mctx;
+	isc_mutex_t		lock;
+	unsigned int		size;
+	unsigned int		count;
+	unsigned int		generation;
+	dn_cache_list_t		lru;	/* head = most recently used */
+	dn_cache_list_t		*buckets;
+};
+
+static void ATTR_NONNULLS
+dn_cache_entry_unlink(dn_cache_t *cache, dn_cache_entry_t *entry)
+{
+	ISC_LIST_UNLINK(cache->lru, entry, lru_link);
+	ISC_LIST_UNLINK(cache->buckets[entry->hashval % cache->size], entry,
+			hash_link);
+	INSIST(cache->count > 0);
+	cache->count--;
+
+	isc_mem_free(cache->mctx, entry->dn);
+	SAFE_MEM_PUT_PTR(cache->mctx, entry);
+}
+
+isc_result_t
+dn_cache_create(isc_mem_t *mctx, unsigned int size, dn_cache_t **cachep)
+{
+	dn_cache_t *cache = NULL;
+	unsigned int i;
+
+	REQUIRE(size > 0);
+	REQUIRE(cachep != NULL && *cachep == NULL);
+
+	cache = isc_mem_get(mctx, sizeof(*cache));
+	ZERO_PTR(cache);
+	isc_mem_attach(mctx, &cache->mctx);
+	/* isc_mutex_init failures are now fatal */
+	isc_mutex_init(&cache->lock);
+	cache->size = size;
+	ISC_LIST_INIT(cache->lru);
+
+	cache->buckets = isc_mem_get(mctx, size * sizeof(*cache->buckets));
+	for (i = 0; i < size; i++)
+		ISC_LIST_INIT(cache->buckets[i]);
+
+	*cachep = cache;
+	return ISC_R_SUCCESS;
+}
+
+void
+dn_cache_destroy(dn_cache_t **cachep)
+{
+	dn_cache_t *cache;
+
+	if (cachep == NULL || *cachep == NULL)
+		return;
+
+	cache = *cachep;
+
+	while (!ISC_LIST_EMPTY(cache->lru))
+		dn_cache_entry_unlink(cache, HEAD(cache->lru));
+	isc_mem_put(cache->mctx, cache->buckets,
+		    cache->size * sizeof(*cache->buckets));
+	isc_mutex_destroy(&cache->lock);
+	MEM_PUT_AND_DETACH(cache);
+
+	*cachep = NULL;
+}
+
+/**
+ * Get current generation of the cache. The generation is incremented
+ * each time some entries are flushed. The value has to be obtained before
+ * reading data from zone register and passed to dn_cache_add() so a result
+ * computed from stale zone register data is not inserted into the cache.
+ */
+unsigned int
+dn_cache_generation(dn_cache_t *cache)
+{
+	unsigned int generation;
+
+	LOCK(&cache->lock);
+	generation = cache->generation;
+	UNLOCK(&cache->lock);
+
+	return generation;
+}
+
+/**
+ * Copy cached DN for owner name within the zone to 'target'.
+ *
+ * @param[out] zone_dn_offset Offset of the zone DN in 'target'. Can be NULL.
+ *
+ * @retval ISC_R_SUCCESS
+ * @retval ISC_R_NOTFOUND
+ */
+isc_result_t
+dn_cache_find(dn_cache_t *cache, const dns_name_t *owner,
+	      const dns_name_t *zone, ld_string_t *target,
+	      size_t *zone_dn_offset)
+{
+	isc_result_t result = ISC_R_NOTFOUND;
+	dn_cache_entry_t *entry;
+	unsigned int hashval;
+
+	hashval = name_hash(owner);
+
+	LOCK(&cache->lock);
+	for (entry = HEAD(cache->buckets[hashval % cache->size]);
+	     entry != NULL;
+	     entry = NEXT(entry, hash_link)) {
+		if (entry->hashval != hashval ||
+		    !dns_name_equal(dns_fixedname_name(&entry->owner), owner) ||
+		    !dns_name_equal(dns_fixedname_name(&entry->zone), zone))
+			continue;
+
+		CHECK(str_init_char(target, entry->dn));
+		if (zone_dn_offset != NULL)
+			*zone_dn_offset = entry->zone_dn_offset;
+		/* move entry to the front of LRU list */
+		ISC_LIST_UNLINK(cache->lru, entry, lru_link);
+		ISC_LIST_PREPEND(cache->lru, entry, lru_link);
+		break;
+	}
+
+cleanup:
+	UNLOCK(&cache->lock);
+	return result;
+}
+
+/**
+ * Remember DN for owner name within the zone. The least recently used entry
+ * is evicted if the cache is full.
+ *
+ * @param[in] generation Value returned by dn_cache_generation() before
+ *                       the DN was computed. Nothing is stored if the cache
+ *                       was flushed in the meantime.
+ */
+void
+dn_cache_add(dn_cache_t *cache, unsigned int generation,
+	     const dns_name_t *owner, const dns_name_t *zone,
+	     const char *dn, size_t zone_dn_offset)
+{
+	dn_cache_entry_t *entry;
+	unsigned int hashval;
+
+	REQUIRE(zone_dn_offset <= strlen(dn));
+
+	hashval = name_hash(owner);
+
+	LOCK(&cache->lock);
+	if (generation != cache->generation)
+		goto unlock;
+
+	for (entry = HEAD(cache->buckets[hashval % cache->size]);
+	     entry != NULL;
+	     entry = NEXT(entry, hash_link)) {
+		if (entry->hashval == hashval &&
+		    dns_name_equal(dns_fixedname_name(&entry->owner), owner) &&
+		    dns_name_equal(dns_fixedname_name(&entry->zone), zone))
+			goto unlock;
+	}
+
+	if (cache->count >= cache->size)
+		dn_cache_entry_unlink(cache, TAIL(cache->lru));
+
+	entry = isc_mem_get(cache->mctx, sizeof(*entry));
+	ZERO_PTR(entry);
+	dns_fixedname_init(&entry->owner);
+	dns_fixedname_init(&entry->zone);
+	dns_name_copynf(owner, dns_fixedname_name(&entry->owner));
+	dns_name_copynf(zone, dns_fixedname_name(&entry->zone));
+	entry->dn = isc_mem_strdup(cache->mctx, dn);
+	entry->zone_dn_offset = zone_dn_offset;
+	entry->hashval = hashval;
+	ISC_LINK_INIT(entry, lru_link);
+	ISC_LINK_INIT(entry, hash_link);
+
+	ISC_LIST_PREPEND(cache->lru, entry, lru_link);
+	ISC_LIST_PREPEND(cache->buckets[hashval % cache->size], entry,
+			 hash_link);
+	cache->count++;
+
+unlock:
+	UNLOCK(&cache->lock);
+}
+
+/**
+ * Remove all entries belonging to the zone and invalidate all DNs
+ * which are being computed at the moment.
+ */
+void
+dn_cache_flush_zone(dn_cache_t *cache, const dns_name_t *zone)
+{
+	dn_cache_entry_t *entry;
+	dn_cache_entry_t *next;
+
+	LOCK(&cache->lock);
+	cache->generation++;
+	for (entry = HEAD(cache->lru); entry != NULL; entry = next) {
+		next = NEXT(entry, lru_link);
+		if (dns_name_equal(dns_fixedname_name(&entry->zone), zone))
+			dn_cache_entry_unlink(cache, entry);
+	}
+	UNLOCK(&cache->lock);
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2026  bind-dyndb-ldap authors; see COPYING for license
+ */
+
+#ifndef _LD_DN_CACHE_H_
+#define _LD_DN_CACHE_H_
+
+#include <dns/name.h>
+
+#include "str.h"
+#include "util.h"
+
+/* Maximal number of owner names remembered by one cache. */
+#define DN_CACHE_SIZE	1024
+
+typedef struct dn_cache dn_cache_t;
+
+isc_result_t
+dn_cache_create(isc_mem_t *mctx, unsigned int size,
+		dn_cache_t **cachep) ATTR_NONNULLS ATTR_CHECKRESULT;
+
+void
+dn_cache_destroy(dn_cache_t **cachep) ATTR_NONNULLS;
+
+unsigned int
+dn_cache_generation(dn_cache_t *cache) ATTR_NONNULLS ATTR_CHECKRESULT;
+
+isc_result_t
+dn_cache_find(dn_cache_t *cache, const dns_name_t *owner,
+	      const dns_name_t *zone, ld_string_t *target,
+	      size_t *zone_dn_offset) ATTR_NONNULL(1,2,3,4) ATTR_CHECKRESULT;
+
+void
+dn_cache_add(dn_cache_t *cache, unsigned int generation,
+	     const dns_name_t *owner, const dns_name_t *zone,
+	     const char *dn, size_t zone_dn_offset) ATTR_NONNULLS;
+
+void
+dn_cache_flush_zone(dn_cache_t *cache, const dns_name_t *zone) ATTR_NONNULLS;
+
+#endif /* !_LD_DN_CACHE_H_ */
@@ -0,0 +1,316 @@
+/*
+ * Copyright (C) 2026  bind-dyndb-ldap authors; see COPYING for license
+ */
+
+#include <isc/mem.h>
+#include <isc/mutex.h>
+#include <isc/util.h>
+
+#include <dns/fixedname.h>
+#include <dns/name.h>
+
+#include <time.h>
+
+#include "dyndb-config.h"
+#include "echo_filter.h"
+#include "util.h"
+
+#define ECHO_FILTER_BUCKETS	256
+
+/**
+ * The echo filter remembers changes written to LDAP by this server.
+ *
+ * Each successful write to LDAP is followed by the very same change coming
+ * back through syncrepl. The filter stores owner name and digest of record
+ * data the LDAP entry is expected to contain after the write so
+ * the syncrepl echo can be recognized and dropped without parsing the entry
+ * and diffing it against RBTDB.
+ *
+ * Expectations for one name have to be matched in the order they were
+ * committed. Any mismatch means that somebody else changed the entry
+ * in the meantime so all expectations for the name are dropped and the
+ * entry is processed as usual.
+ */
+typedef ISC_LIST(echo_expect_t) echo_expectlist_t;
+
+struct echo_expect {
+	dns_fixedname_t			name;
+	echo_digest_t			digest;
+	unsigned int			hashval;
+	time_t				expire;
+	ISC_LINK(echo_expect_t)		fifo_link;
+	ISC_LINK(echo_expect_t)		hash_link;
+};
+
+struct echo_filter {
+	isc_mem_t		*mctx;
+	isc_mutex_t		lock;
+	unsigned int		count;
+	echo_expectlist_t	fifo;	/* head = oldest expectation */
+	echo_expectlist_t	buckets[ECHO_FILTER_BUCKETS];
+};
+
+#define FNV64_OFFSET	14695981039346656037ULL
+#define FNV64_PRIME	1099511628211ULL
+
+static uint64_t ATTR_NONNULLS ATTR_CHECKRESULT
+fnv64_update(uint64_t hashval, const unsigned char *data, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		hashval ^= data[i];
+		hashval *= FNV64_PRIME;
+	}
+
+	return hashval;
+}
+
+static void ATTR_NONNULLS
+echo_expect_unlink(echo_filter_t *ef, echo_expect_t *expect)
+{
+	ISC_LIST_UNLINK(ef->fifo, expect, fifo_link);
+	ISC_LIST_UNLINK(ef->buckets[expect->hashval % ECHO_FILTER_BUCKETS],
+			expect, hash_link);
+	INSIST(ef->count > 0);
+	ef->count--;
+	SAFE_MEM_PUT_PTR(ef->mctx, expect);
+}
+
+/**
+ * Forget expectations which did not arrive in time.
+ *
+ * @pre ef->lock is locked.
+ */
+static void ATTR_NONNULLS
+echo_filter_expire(echo_filter_t *ef, time_t now)
+{
+	echo_expect_t *expect;
+
+	while ((expect = HEAD(ef->fifo)) != NULL && expect->expire <= now)
+		echo_expect_unlink(ef, expect);
+}
+
+isc_result_t
+echo_filter_create(isc_mem_t *mctx, echo_filter_t **efp)
+{
+	echo_filter_t *ef = NULL;
+	unsigned int i;
+
+	REQUIRE(efp != NULL && *efp == NULL);
+
+	ef = isc_mem_get(mctx, sizeof(*ef));
+	ZERO_PTR(ef);
+	isc_mem_attach(mctx, &ef->mctx);
+	/* isc_mutex_init failures are now fatal */
+	isc_mutex_init(&ef->lock);
+	ISC_LIST_INIT(ef->fifo);
+	for (i = 0; i < ECHO_FILTER_BUCKETS; i++)
+		ISC_LIST_INIT(ef->buckets[i]);
+
+	*efp = ef;
+	return ISC_R_SUCCESS;
+}
+
+void
+echo_filter_destroy(echo_filter_t **efp)
+{
+	echo_filter_t *ef;
+
+	if (efp == NULL || *efp == NULL)
+		return;
+
+	ef = *efp;
+
+	while (!ISC_LIST_EMPTY(ef->fifo))
+		echo_expect_unlink(ef, HEAD(ef->fifo));
+	isc_mutex_destroy(&ef->lock);
+	MEM_PUT_AND_DETACH(ef);
+
+	*efp = NULL;
+}
+
+/**
+ * Digest of record data is a sum of hashes of individual values so it does
+ * not depend on order of values returned by LDAP server.
+ */
+void
+echo_digest_init(echo_digest_t *digest)
+{
+	*digest = 0;
+}
+
+void
+echo_digest_value(echo_digest_t *digest, dns_rdatatype_t rdtype,
+		  const char *value, size_t len)
+{
+	uint64_t hashval = FNV64_OFFSET;
+	uint16_t type = rdtype;
+
+	hashval = fnv64_update(hashval, (const unsigned char *)&type,
+			       sizeof(type));
+	hashval = fnv64_update(hashval, (const unsigned char *)value, len);
+	*digest += hashval;
+}
+
+void
+echo_digest_ttl(echo_digest_t *digest, dns_ttl_t ttl)
+{
+	uint64_t hashval = FNV64_OFFSET;
+
+	hashval = fnv64_update(hashval, (const unsigned char *)"TTL",
+			       sizeof("TTL"));
+	hashval = fnv64_update(hashval, (const unsigned char *)&ttl,
+			       sizeof(ttl));
+	*digest += hashval;
+}
+
+/**
+ * Add expectation to a list of changes which were written to LDAP
+ * but which were not committed to RBTDB yet.
+ */
+void
+echo_pending_add(isc_mem_t *mctx, echo_pendinglist_t *pending,
+		 const dns_name_t *name, echo_digest_t digest)
+{
+	echo_expect_t *expect;
+
+	expect = isc_mem_get(mctx, sizeof(*expect));
+	ZERO_PTR(expect);
+	dns_fixedname_init(&expect->name);
+	dns_name_copynf(name, dns_fixedname_name(&expect->name));
+	expect->digest = digest;
+	expect->hashval = name_hash(name);
+	ISC_LINK_INIT(expect, fifo_link);
+	ISC_LINK_INIT(expect, hash_link);
+	ISC_LIST_APPEND(*pending, expect, fifo_link);
+}
+
+void
+echo_pending_clear(isc_mem_t *mctx, echo_pendinglist_t *pending)
+{
+	echo_expect_t *expect;
+
+	while ((expect = HEAD(*pending)) != NULL) {
+		ISC_LIST_UNLINK(*pending, expect, fifo_link);
+		SAFE_MEM_PUT_PTR(mctx, expect);
+	}
+}
+
+/**
+ * Move pending expectations to the filter. This has to be called only
+ * after the changes were committed to RBTDB, otherwise the syncrepl
+ * echo would be the only way to fix RBTDB after rollback.
+ *
+ * Pending list is empty after the call.
+ */
+void
+echo_filter_commit(echo_filter_t *ef, isc_mem_t *mctx,
+		   echo_pendinglist_t *pending)
+{
+	echo_expect_t *pexpect;
+	echo_expect_t *expect;
+	time_t now = time(NULL);
+
+	LOCK(&ef->lock);
+	echo_filter_expire(ef, now);
+	for (pexpect = HEAD(*pending);
+	     pexpect != NULL;
+	     pexpect = NEXT(pexpect, fifo_link)) {
+		if (ef->count >= ECHO_FILTER_SIZE)
+			echo_expect_unlink(ef, HEAD(ef->fifo));
+
+		expect = isc_mem_get(ef->mctx, sizeof(*expect));
+		ZERO_PTR(expect);
+		dns_fixedname_init(&expect->name);
+		dns_name_copynf(dns_fixedname_name(&pexpect->name),
+				dns_fixedname_name(&expect->name));
+		expect->digest = pexpect->digest;
+		expect->hashval = pexpect->hashval;
+		expect->expire = now + ECHO_FILTER_TIMEOUT;
+		ISC_LINK_INIT(expect, fifo_link);
+		ISC_LINK_INIT(expect, hash_link);
+		ISC_LIST_APPEND(ef->fifo, expect, fifo_link);
+		ISC_LIST_APPEND(ef->buckets[expect->hashval
+					    % ECHO_FILTER_BUCKETS],
+				expect, hash_link);
+		ef->count++;
+	}
+	UNLOCK(&ef->lock);
+
+	echo_pending_clear(mctx, pending);
+}
+
+/**
+ * Quick check if there is any expectation for the name. It allows caller
+ * to skip digest computation for entries which were not written by us.
+ */
+bool
+echo_filter_expects(echo_filter_t *ef, const dns_name_t *name)
+{
+	echo_expect_t *expect;
+	unsigned int hashval;
+	bool found = false;
+
+	LOCK(&ef->lock);
+	if (ef->count == 0)
+		goto unlock;
+
+	hashval = name_hash(name);
+	for (expect = HEAD(ef->buckets[hashval % ECHO_FILTER_BUCKETS]);
+	     expect != NULL && !found;
+	     expect = NEXT(expect, hash_link))
+		found = (expect->hashval == hashval &&
+			 dns_name_equal(dns_fixedname_name(&expect->name),
+					name));
+
+unlock:
+	UNLOCK(&ef->lock);
+	return found;
+}
+
+/**
+ * Check if change received from LDAP is an echo of our own write.
+ *
+ * @retval true  Oldest expectation for the name has matching digest.
+ *               The expectation is consumed.
+ * @retval false There is no expectation for the name or the digest does not
+ *               match. All expectations for the name are dropped in the
+ *               latter case.
+ */
+bool
+echo_filter_match(echo_filter_t *ef, const dns_name_t *name,
+		  echo_digest_t digest)
+{
+	echo_expect_t *expect;
+	echo_expect_t *next;
+	unsigned int hashval;
+	bool first = true;
+	bool match = false;
+
+	hashval = name_hash(name);
+
+	LOCK(&ef->lock);
+	echo_filter_expire(ef, time(NULL));
+	for (expect = HEAD(ef->buckets[hashval % ECHO_FILTER_BUCKETS]);
+	     expect != NULL;
+	     expect = next) {
+		next = NEXT(expect, hash_link);
+		if (expect->hashval != hashval ||
+		    !dns_name_equal(dns_fixedname_name(&expect->name), name))
+			continue;
+
+		if (first) {
+			first = false;
+			match = (expect->digest == digest);
+			echo_expect_unlink(ef, expect);
+			if (match)
+				break;
+		} else {
+			echo_expect_unlink(ef, expect);
+		}
+	}
+	UNLOCK(&ef->lock);
+
+	return match;
+}
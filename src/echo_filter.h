@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2026  bind-dyndb-ldap authors; see COPYING for license
+ */
+
+#ifndef _LD_ECHO_FILTER_H_
+#define _LD_ECHO_FILTER_H_
+
+#include <isc/list.h>
+#include <dns/name.h>
+#include <dns/types.h>
+
+#include <stdint.h>
+
+#include "util.h"
+
+/* Maximal number of expected echoes remembered by one filter. */
+#define ECHO_FILTER_SIZE	4096
+/* Expected echo is forgotten if it does not arrive within this time. */
+#define ECHO_FILTER_TIMEOUT	60 /* seconds */
+
+typedef uint64_t echo_digest_t;
+typedef struct echo_filter echo_filter_t;
+typedef struct echo_expect echo_expect_t;
+typedef ISC_LIST(echo_expect_t) echo_pendinglist_t;
+
+isc_result_t
+echo_filter_create(isc_mem_t *mctx, echo_filter_t **efp) ATTR_NONNULLS ATTR_CHECKRESULT;
+
+void
+echo_filter_destroy(echo_filter_t **efp) ATTR_NONNULLS;
+
+void
+echo_digest_init(echo_digest_t *digest) ATTR_NONNULLS;
+
+void
+echo_digest_value(echo_digest_t *digest, dns_rdatatype_t rdtype,
+		  const char *value, size_t len) ATTR_NONNULLS;
+
+void
+echo_digest_ttl(echo_digest_t *digest, dns_ttl_t ttl) ATTR_NONNULLS;
+
+void
+echo_pending_add(isc_mem_t *mctx, echo_pendinglist_t *pending,
+		 const dns_name_t *name, echo_digest_t digest) ATTR_NONNULLS;
+
+void
+echo_pending_clear(isc_mem_t *mctx, echo_pendinglist_t *pending) ATTR_NONNULLS;
+
+void
+echo_filter_commit(echo_filter_t *ef, isc_mem_t *mctx,
+		   echo_pendinglist_t *pending) ATTR_NONNULLS;
+
+bool
+echo_filter_expects(echo_filter_t *ef, const dns_name_t *name) ATTR_NONNULLS ATTR_CHECKRESULT;
+
+bool
+echo_filter_match(echo_filter_t *ef, const dns_name_t *name,
+		  echo_digest_t digest) ATTR_NONNULLS ATTR_CHECKRESULT;
+
+#endif /* !_LD_ECHO_FILTER_H_ */
@@ -395,6 +395,7 @@ cleanup:
  *       Setting forwarders may be left unset if no forwarders are specified.
  *
  * @retval ISC_R_SUCCESS         Config was parsed and stored in settings
+ * @retval ISC_R_IGNORE          Config in settings was already up to date.
  * @retval errors                Forwarding policy is invalid
  *                               or specified forwarders are invalid.
  */
@@ -407,6 +408,7 @@ fwd_parse_ldap(ldap_entry_t *entry, settings_set_t *set) {
 	isc_buffer_t *tmp_buf = NULL; /* hack: only the base buffer is allocated */
 	dns_forwarderlist_t fwdrs;
 	const char *setting_str = NULL;
+	bool filled;
 
 	/**
 	 * BIND forward policies are "first" (default) or "only".
@@ -435,19 +437,25 @@ fwd_parse_ldap(ldap_entry_t *entry, settings_set_t *set) {
 				  ldap_entry_logname(entry), value->value);
 			CLEANUP_WITH(ISC_R_UNEXPECTEDTOKEN);
 		}
+		result = setting_update_from_ldap_entry("forward_policy", set,
+							"idnsForwardPolicy",
+							entry);
+	} else {
+		/* Set the default directly so an unchanged default
+		 * is not reported as a change. Filling in the default
+		 * for the first time is not a change either. */
+		filled = (setting_find("forward_policy", set, false, true,
+				       NULL) == ISC_R_SUCCESS);
+		result = setting_set("forward_policy", set, "first");
+		if (result == ISC_R_SUCCESS && filled == false) {
+			log_debug(2, "defaulting to forward policy 'first' "
+				  "for %s", ldap_entry_logname(entry));
+			result = ISC_R_IGNORE;
+		}
 	}
-	result = setting_update_from_ldap_entry("forward_policy", set,
-						"idnsForwardPolicy",
-						entry);
 	first = result;
 	if (result != ISC_R_SUCCESS && result != ISC_R_IGNORE)
 		goto cleanup;
-	result = setting_find("forward_policy", set, false, true, NULL);
-	if (result == ISC_R_NOTFOUND) {
-		log_debug(2, "defaulting to forward policy 'first' for "
-			  "%s", ldap_entry_logname(entry));
-		CHECK(setting_set("forward_policy", set, "first"));
-	}
 
 	/* forwarders */
 	result = ldap_entry_getvalues(entry, "idnsForwarders", &values);
@@ -563,7 +571,8 @@ fwd_configure_zone(const settings_set_t *set, ldap_instance_t *inst,
 	}
 
 	if (isconfigured == true) {
-		CHECK(setting_get_str("forward_policy", set, &fwdpolicy_str));
+		CHECK(setting_get_str(SETTING_FORWARD_POLICY, set,
+				      &fwdpolicy_str));
 		result = get_enum_value(forwarder_policy_txts,
 					fwdpolicy_str, (int *)&fwdpolicy);
 		INSIST(result == ISC_R_SUCCESS);
@@ -575,7 +584,8 @@ fwd_configure_zone(const settings_set_t *set, ldap_instance_t *inst,
 				  msg_obj_type, set->name);
 			ISC_LIST_INIT(fwdrs);
 		} else {
-			CHECK(setting_get_str("forwarders", set, &forwarders_str));
+			CHECK(setting_get_str(SETTING_FORWARDERS, set,
+					      &forwarders_str));
 			CHECK(fwd_parse_str(forwarders_str, mctx, &fwdrs));
 		}
 	} else {
@@ -650,7 +660,7 @@ fwd_reconfig_global(ldap_instance_t *inst) {
 				      &toplevel_settings);
 	if (result == ISC_R_SUCCESS)
 		/* is root zone active? */
-		CHECK(setting_get_bool("active", toplevel_settings,
+		CHECK(setting_get_bool(SETTING_ACTIVE, toplevel_settings,
 				       &root_zone_is_active));
 	else if (result != ISC_R_NOTFOUND)
 		goto cleanup;
@@ -4,6 +4,8 @@
 
 #define _POSIX_C_SOURCE 200112L /* setenv */
 
+#include <isc/mem.h>
+#include <isc/mutex.h>
 #include <isc/util.h>
 #include <string.h>
 #include <stdlib.h>
@@ -16,6 +18,28 @@
 #define DEFAULT_KEYTAB "FILE:/etc/named.keytab"
 #define MIN_TIME 300 /* 5 minutes */
 
+/**
+ * Kerberos context and MEMORY credentials cache of one LDAP instance.
+ *
+ * Both are created once and kept for the lifetime of the instance. Expiration
+ * time of the TGT is remembered so that the common case, a reconnect while
+ * the TGT is still valid, does not need any Kerberos library call.
+ * New TGT is obtained from the keytab only when the remembered one is about
+ * to expire. Lock protects all members because krb5_context must not be
+ * used from multiple threads at once.
+ */
+struct krb5_tgt_cache {
+	isc_mem_t		*mctx;
+	isc_mutex_t		lock;
+	char			*principal;
+	char			*keyfile;
+	char			*ccname;
+	krb5_context		context;
+	krb5_ccache		ccache;
+	krb5_principal		kprincpw;
+	krb5_timestamp		endtime; /* 0 = no valid TGT known */
+};
+
 #define CHECK_KRB5(ctx, err, msg, ...)					\
 	do {								\
 		if (err) {						\
@@ -30,7 +54,8 @@
 static isc_result_t ATTR_CHECKRESULT
 check_credentials(krb5_context context,
 		  krb5_ccache ccache,
-		  krb5_principal service)
+		  krb5_principal service,
+		  krb5_timestamp *endtime)
 {
 	char *realm = NULL;
 	krb5_creds creds;
@@ -74,6 +99,7 @@ check_credentials(krb5_context context,
 		goto cleanup;
 	}
 
+	*endtime = creds.times.endtime;
 	result = ISC_R_SUCCESS;
 
 cleanup:
@@ -84,21 +110,16 @@ cleanup:
 }
 
 isc_result_t
-get_krb5_tgt(isc_mem_t *mctx, const char *principal, const char *keyfile)
+krb5_tgt_cache_create(isc_mem_t *mctx, const char *principal,
+		      const char *keyfile, krb5_tgt_cache_t **cachep)
 {
+	krb5_tgt_cache_t *cache = NULL;
 	ld_string_t *ccname = NULL;
-	krb5_context context = NULL;
-	krb5_keytab keytab = NULL;
-	krb5_ccache ccache = NULL;
-	krb5_principal kprincpw = NULL;
-	krb5_creds my_creds;
-	krb5_creds * my_creds_ptr = NULL;
-	krb5_get_init_creds_opt options;
 	krb5_error_code krberr;
 	isc_result_t result;
-	int ret;
 
 	REQUIRE(principal != NULL && principal[0] != '\0');
+	REQUIRE(cachep != NULL && *cachep == NULL);
 
 	if (keyfile == NULL || keyfile[0] == '\0') {
 		log_debug(2, "Using default keytab file name: %s",
@@ -112,7 +133,15 @@ get_krb5_tgt(isc_mem_t *mctx, const char *principal, const char *keyfile)
 		}
 	}
 
-	krberr = krb5_init_context(&context);
+	cache = isc_mem_get(mctx, sizeof(*cache));
+	ZERO_PTR(cache);
+	isc_mem_attach(mctx, &cache->mctx);
+	/* isc_mutex_init failures are now fatal */
+	isc_mutex_init(&cache->lock);
+	cache->principal = isc_mem_strdup(mctx, principal);
+	cache->keyfile = isc_mem_strdup(mctx, keyfile);
+
+	krberr = krb5_init_context(&cache->context);
 	/* This will blow up with older versions of Heimdal Kerberos, but
 	 * this kind of errors are not debuggable without any error message.
 	 * http://mailman.mit.edu/pipermail/kerberos/2013-February/018720.html */
@@ -121,27 +150,99 @@ get_krb5_tgt(isc_mem_t *mctx, const char *principal, const char *keyfile)
 	/* get credentials cache */
 	CHECK(str_new(mctx, &ccname));
 	CHECK(str_sprintf(ccname, "MEMORY:_ld_krb5_cc_%s", principal));
+	cache->ccname = isc_mem_strdup(mctx, str_buf(ccname));
 
-	ret = setenv("KRB5CCNAME", str_buf(ccname), 1);
-	if (ret == -1) {
-		log_error("Failed to set KRB5CCNAME environment variable to "
-			  "'%s'", str_buf(ccname));
-		result = ISC_R_FAILURE;
-		goto cleanup;
-	}
-
-	krberr = krb5_cc_resolve(context, str_buf(ccname), &ccache);
-	CHECK_KRB5(context, krberr,
+	krberr = krb5_cc_resolve(cache->context, cache->ccname,
+				 &cache->ccache);
+	CHECK_KRB5(cache->context, krberr,
 		   "Failed to resolve credentials cache name '%s'",
-		   str_buf(ccname));
+		   cache->ccname);
 
 	/* get krb5_principal from string */
-	krberr = krb5_parse_name(context, principal, &kprincpw);
-	CHECK_KRB5(context, krberr,
+	krberr = krb5_parse_name(cache->context, principal, &cache->kprincpw);
+	CHECK_KRB5(cache->context, krberr,
 		   "Failed to parse the principal name '%s'", principal);
 
+	*cachep = cache;
+	cache = NULL;
+	result = ISC_R_SUCCESS;
+
+cleanup:
+	if (ccname) str_destroy(&ccname);
+	krb5_tgt_cache_destroy(&cache);
+	return result;
+}
+
+void
+krb5_tgt_cache_destroy(krb5_tgt_cache_t **cachep)
+{
+	krb5_tgt_cache_t *cache;
+
+	if (cachep == NULL || *cachep == NULL)
+		return;
+
+	cache = *cachep;
+
+	if (cache->context) {
+		if (cache->kprincpw)
+			krb5_free_principal(cache->context, cache->kprincpw);
+		if (cache->ccache)
+			krb5_cc_close(cache->context, cache->ccache);
+		krb5_free_context(cache->context);
+	}
+	if (cache->ccname) isc_mem_free(cache->mctx, cache->ccname);
+	isc_mem_free(cache->mctx, cache->keyfile);
+	isc_mem_free(cache->mctx, cache->principal);
+	isc_mutex_destroy(&cache->lock);
+	MEM_PUT_AND_DETACH(cache);
+
+	*cachep = NULL;
+}
+
+/**
+ * Make sure the credentials cache contains TGT which is valid for at least
+ * MIN_TIME seconds. Keytab is used only if the remembered TGT is about
+ * to expire, so concurrent reconnects wait for the lock only while one
+ * of them obtains a new TGT.
+ */
+isc_result_t
+krb5_tgt_cache_get(krb5_tgt_cache_t *cache)
+{
+	krb5_keytab keytab = NULL;
+	krb5_creds my_creds;
+	krb5_creds * my_creds_ptr = NULL;
+	krb5_get_init_creds_opt options;
+	krb5_timestamp now;
+	krb5_error_code krberr;
+	const char *envname;
+	isc_result_t result;
+	int ret;
+
+	LOCK(&cache->lock);
+
+	/* Other instances might use a different principal. */
+	envname = getenv("KRB5CCNAME");
+	if (envname == NULL || strcmp(envname, cache->ccname) != 0) {
+		ret = setenv("KRB5CCNAME", cache->ccname, 1);
+		if (ret == -1) {
+			log_error("Failed to set KRB5CCNAME environment "
+				  "variable to '%s'", cache->ccname);
+			result = ISC_R_FAILURE;
+			goto cleanup;
+		}
+	}
+
+	krberr = krb5_timeofday(cache->context, &now);
+	CHECK_KRB5(cache->context, krberr, "Failed to get timeofday");
+	if (cache->endtime != 0 && now <= cache->endtime - MIN_TIME) {
+		result = ISC_R_SUCCESS;
+		goto cleanup;
+	}
+	cache->endtime = 0;
+
 	/* check if we already have valid credentials */
-	result = check_credentials(context, ccache, kprincpw);
+	result = check_credentials(cache->context, cache->ccache,
+				   cache->kprincpw, &cache->endtime);
 	if (result == ISC_R_SUCCESS) {
 		log_debug(2, "Found valid Kerberos credentials in cache");
 		goto cleanup;
@@ -150,9 +251,9 @@ get_krb5_tgt(isc_mem_t *mctx, const char *principal, const char *keyfile)
 	}
 
 	/* open keytab */
-	krberr = krb5_kt_resolve(context, keyfile, &keytab);
-	CHECK_KRB5(context, krberr,
-		   "Failed to resolve keytab file '%s'", keyfile);
+	krberr = krb5_kt_resolve(cache->context, cache->keyfile, &keytab);
+	CHECK_KRB5(cache->context, krberr,
+		   "Failed to resolve keytab file '%s'", cache->keyfile);
 
 	memset(&my_creds, 0, sizeof(my_creds));
 	memset(&options, 0, sizeof(options));
@@ -162,30 +263,32 @@ get_krb5_tgt(isc_mem_t *mctx, const char *principal, const char *keyfile)
 	krb5_get_init_creds_opt_set_proxiable(&options, 0);
 
 	/* get tgt */
-	krberr = krb5_get_init_creds_keytab(context, &my_creds, kprincpw,
-					    keytab, 0, NULL, &options);
-	CHECK_KRB5(context, krberr, "Failed to get initial credentials (TGT) "
-				    "using principal '%s' and keytab '%s'",
-				    principal, keyfile);
+	krberr = krb5_get_init_creds_keytab(cache->context, &my_creds,
+					    cache->kprincpw, keytab, 0, NULL,
+					    &options);
+	CHECK_KRB5(cache->context, krberr, "Failed to get initial credentials "
+		   "(TGT) using principal '%s' and keytab '%s'",
+		   cache->principal, cache->keyfile);
 	my_creds_ptr = &my_creds;
 
 	/* store credentials in cache */
-	krberr = krb5_cc_initialize(context, ccache, kprincpw);
-	CHECK_KRB5(context, krberr, "Failed to initialize credentials cache "
-				    "'%s'", str_buf(ccname));
+	krberr = krb5_cc_initialize(cache->context, cache->ccache,
+				    cache->kprincpw);
+	CHECK_KRB5(cache->context, krberr, "Failed to initialize credentials "
+		   "cache '%s'", cache->ccname);
 
-	krberr = krb5_cc_store_cred(context, ccache, &my_creds);
-	CHECK_KRB5(context, krberr, "Failed to store credentials "
-				    "in credentials cache '%s'", str_buf(ccname));
+	krberr = krb5_cc_store_cred(cache->context, cache->ccache, &my_creds);
+	CHECK_KRB5(cache->context, krberr, "Failed to store credentials "
+		   "in credentials cache '%s'", cache->ccname);
 
+	cache->endtime = my_creds.times.endtime;
+	log_debug(2, "Kerberos credentials valid until %ld",
+		  (long) cache->endtime);
 	result = ISC_R_SUCCESS;
 
 cleanup:
-	if (ccname) str_destroy(&ccname);
-	if (ccache) krb5_cc_close(context, ccache);
-	if (keytab) krb5_kt_close(context, keytab);
-	if (kprincpw) krb5_free_principal(context, kprincpw);
-	if (my_creds_ptr) krb5_free_cred_contents(context, my_creds_ptr);
-	if (context) krb5_free_context(context);
+	if (keytab) krb5_kt_close(cache->context, keytab);
+	if (my_creds_ptr) krb5_free_cred_contents(cache->context, my_creds_ptr);
+	UNLOCK(&cache->lock);
 	return result;
 }
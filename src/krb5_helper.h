@@ -2,5 +2,14 @@
  * Copyright (C) 2009-2014  bind-dyndb-ldap authors; see COPYING for license
  */
 
+typedef struct krb5_tgt_cache krb5_tgt_cache_t;
+
+isc_result_t
+krb5_tgt_cache_create(isc_mem_t *mctx, const char *principal,
+		      const char *keyfile, krb5_tgt_cache_t **cachep) ATTR_NONNULL(1,2,4) ATTR_CHECKRESULT;
+
+void
+krb5_tgt_cache_destroy(krb5_tgt_cache_t **cachep) ATTR_NONNULLS;
+
 isc_result_t
-get_krb5_tgt(isc_mem_t *mctx, const char *principal, const char *keyfile) ATTR_NONNULLS ATTR_CHECKRESULT;
+krb5_tgt_cache_get(krb5_tgt_cache_t *cache) ATTR_NONNULLS ATTR_CHECKRESULT;
@@ -314,11 +314,26 @@ cleanup:
 	return result;
 }
 
+/**
+ * Convert DNS name within the zone to LDAP DN.
+ *
+ * Results are remembered in DN cache associated with the zone register
+ * so repeated conversions of the same name do not need to escape the name
+ * again.
+ *
+ * @param[out] target         DN of the owner name.
+ * @param[out] zone_dn_offset Offset of the zone DN inside 'target',
+ *                            i.e. target + offset points to DN
+ *                            of the zone. Can be NULL.
+ */
 isc_result_t
 dnsname_to_dn(zone_register_t *zr, dns_name_t *name, dns_name_t *zone,
-	      ld_string_t *target)
+	      ld_string_t *target, size_t *zone_dn_offset)
 {
 	isc_result_t result;
+	dn_cache_t *dn_cache;
+	unsigned int cache_gen;
+	size_t offset;
 	int label_count;
 	const char *zone_dn = NULL;
 	char *dns_str = NULL;
@@ -336,6 +351,12 @@ dnsname_to_dn(zone_register_t *zr, dns_name_t *name, dns_name_t *zone,
 	isc_mem_t * mctx = zr_get_mctx(zr);
 	str_clear(target);
 
+	dn_cache = zr_get_dn_cache(zr);
+	result = dn_cache_find(dn_cache, name, zone, target, zone_dn_offset);
+	if (result != ISC_R_NOTFOUND)
+		return result;
+	cache_gen = dn_cache_generation(dn_cache);
+
 	/* Find the DN of the zone we belong to. */
 	CHECK(zr_get_zone_dn(zr, zone, &zone_dn));
 
@@ -350,14 +371,15 @@ dnsname_to_dn(zone_register_t *zr, dns_name_t *name, dns_name_t *zone,
 		CHECK(dns_to_ldap_dn_escape(mctx, dns_str, &escaped_name));
 		CHECK(str_cat_char(target, "idnsName="));
 		CHECK(str_cat_char(target, escaped_name));
-		/* 
-		 * Modification of following line can affect modify_ldap_common().
-		 * See line with: char *zone_dn = strstr(str_buf(owner_dn),", ") + 1;  
-		 */
 		CHECK(str_cat_char(target, ", "));
 	}
+	offset = str_len(target);
 	CHECK(str_cat_char(target, zone_dn));
 
+	dn_cache_add(dn_cache, cache_gen, name, zone, str_buf(target), offset);
+	if (zone_dn_offset != NULL)
+		*zone_dn_offset = offset;
+
 cleanup:
 	if (dns_str)
 		isc_mem_free(mctx, dns_str);
@@ -37,6 +37,7 @@
 #include <string.h> /* For memcpy */
 
 #include "bindcfg.h"
+#include "echo_filter.h"
 #include "ldap_driver.h"
 #include "ldap_helper.h"
 #include "ldap_convert.h"
@@ -93,6 +94,11 @@ struct ldapdb {
 	 * The purpose is to detect moment when the new version is closed.
 	 * That is the right time for unlocking newversion_lock. */
 	dns_dbversion_t			*newversion;
+
+	/**
+	 * Syncrepl echoes expected for changes written to LDAP within
+	 * newversion. Protected by newversion_lock. */
+	echo_pendinglist_t		echo_pending;
 };
 
 dns_db_t * ATTR_NONNULLS
@@ -175,6 +181,7 @@ cleanup:
 #endif
 	dns_db_detach(&ldapdb->rbtdb);
 	dns_name_free(&ldapdb->common.origin, ldapdb->common.mctx);
+	echo_pending_clear(ldapdb->common.mctx, &ldapdb->echo_pending);
 	/* isc_mutex_destroy is failing fatal now */
 	isc_mutex_destroy(&ldapdb->newversion_lock);
 	isc_mem_putanddetach(&ldapdb->common.mctx, ldapdb, sizeof(*ldapdb));
@@ -347,6 +354,14 @@ closeversion(dns_db_t *db, dns_dbversion_t **versionp, bool commit)
 
 	dns_db_closeversion(ldapdb->rbtdb, versionp, commit);
 	if (closed_version == ldapdb->newversion) {
+		if (commit == true)
+			echo_filter_commit(ldap_instance_getechofilter(
+						ldapdb->ldap_inst),
+					   ldapdb->common.mctx,
+					   &ldapdb->echo_pending);
+		else
+			echo_pending_clear(ldapdb->common.mctx,
+					   &ldapdb->echo_pending);
 		ldapdb->newversion = NULL;
 		UNLOCK(&ldapdb->newversion_lock);
 	}
@@ -475,6 +490,79 @@ allrdatasets(dns_db_t *db, dns_dbnode_t *node, dns_dbversion_t *version,
 	return dns_db_allrdatasets(ldapdb->rbtdb, node, version, DNS_DB_ALLRDATASETS_OPTIONS(options, now), iteratorp);
 }
 
+/**
+ * Remember digest of data which LDAP entry for the node should contain
+ * after a write done by us so the syncrepl echo of the write can be dropped.
+ * The expectation is activated only if the version is committed,
+ * see closeversion().
+ *
+ * Nothing is remembered if the node data cannot be stored in a single LDAP
+ * entry as they are, e.g. if RRsets in the node have different TTLs.
+ * Errors are not fatal, the echo will be processed as any other change.
+ */
+static void ATTR_NONNULLS
+ldapdb_echo_expect(ldapdb_t *ldapdb, dns_dbnode_t *node,
+		   dns_dbversion_t *version, dns_name_t *name)
+{
+	isc_result_t result;
+	dns_rdatasetiter_t *rds_iter = NULL;
+	dns_rdataset_t rdataset;
+	dns_rdata_t rdata = DNS_RDATA_INIT;
+	echo_digest_t digest;
+	dns_ttl_t ttl = 0;
+	bool empty = true;
+	DECLARE_BUFFER(buffer, DNS_RDATA_MAXLENGTH * 2 + sizeof("\\# 65535 "));
+
+	/* Zone apex is stored in zone object which is handled separately. */
+	if (version != ldapdb->newversion ||
+	    dns_name_equal(name, &ldapdb->common.origin))
+		return;
+
+	dns_rdataset_init(&rdataset);
+	echo_digest_init(&digest);
+	CHECK(dns_db_allrdatasets(ldapdb->rbtdb, node, version,
+				  DNS_DB_ALLRDATASETS_OPTIONS(0, 0),
+				  &rds_iter));
+	for (result = dns_rdatasetiter_first(rds_iter);
+	     result == ISC_R_SUCCESS;
+	     result = dns_rdatasetiter_next(rds_iter)) {
+		dns_rdatasetiter_current(rds_iter, &rdataset);
+		if (empty == true) {
+			ttl = rdataset.ttl;
+			empty = false;
+		} else if (rdataset.ttl != ttl) {
+			CLEANUP_WITH(ISC_R_IGNORE);
+		}
+
+		for (result = dns_rdataset_first(&rdataset);
+		     result == ISC_R_SUCCESS;
+		     result = dns_rdataset_next(&rdataset)) {
+			dns_rdataset_current(&rdataset, &rdata);
+			INIT_BUFFER(buffer);
+			CHECK(dns_rdata_totext(&rdata, NULL, &buffer));
+			echo_digest_value(&digest, rdata.type,
+					  isc_buffer_base(&buffer),
+					  isc_buffer_usedlength(&buffer));
+			dns_rdata_reset(&rdata);
+		}
+		dns_rdataset_disassociate(&rdataset);
+		if (result != ISC_R_NOMORE)
+			goto cleanup;
+	}
+	if (result != ISC_R_NOMORE || empty == true)
+		goto cleanup;
+
+	echo_digest_ttl(&digest, ttl);
+	echo_pending_add(ldapdb->common.mctx, &ldapdb->echo_pending, name,
+			 digest);
+
+cleanup:
+	if (dns_rdataset_isassociated(&rdataset))
+		dns_rdataset_disassociate(&rdataset);
+	if (rds_iter != NULL)
+		dns_rdatasetiter_destroy(&rds_iter);
+}
+
 /* TODO: Add 'tainted' flag to the LDAP instance if something went wrong. */
 static isc_result_t
 addrdataset(dns_db_t *db, dns_dbnode_t *node, dns_dbversion_t *version,
@@ -498,7 +586,14 @@ addrdataset(dns_db_t *db, dns_dbnode_t *node, dns_dbversion_t *version,
 	CHECK(ldapdb_name_fromnode(node, dns_fixedname_name(&fname)));
 	result = dns_rdatalist_fromrdataset(rdataset, &rdlist);
 	INSIST(result == ISC_R_SUCCESS);
-	CHECK(write_to_ldap(dns_fixedname_name(&fname), zname, ldapdb->ldap_inst, rdlist));
+	/* Without merge the RR set in RBTDB was replaced. */
+	if ((options & DNS_DBADD_MERGE) != 0)
+		CHECK(write_to_ldap(dns_fixedname_name(&fname), zname,
+				    ldapdb->ldap_inst, rdlist));
+	else
+		CHECK(replace_in_ldap(dns_fixedname_name(&fname), zname,
+				      ldapdb->ldap_inst, rdlist));
+	ldapdb_echo_expect(ldapdb, node, version, dns_fixedname_name(&fname));
 
 cleanup:
 	return result;
@@ -582,6 +677,9 @@ subtractrdataset(dns_db_t *db, dns_dbnode_t *node, dns_dbversion_t *version,
 	CHECK(ldapdb_name_fromnode(node, dns_fixedname_name(&fname)));
 	CHECK(remove_values_from_ldap(dns_fixedname_name(&fname), zname, ldapdb->ldap_inst,
 				      rdlist, empty_node));
+	if (empty_node == false)
+		ldapdb_echo_expect(ldapdb, node, version,
+				   dns_fixedname_name(&fname));
 
 cleanup:
 	if (result == ISC_R_SUCCESS)
@@ -624,6 +722,8 @@ deleterdataset(dns_db_t *db, dns_dbnode_t *node, dns_dbversion_t *version,
 	} else {
 		CHECK(remove_rdtype_from_ldap(dns_fixedname_name(&fname), zname,
 					    ldapdb->ldap_inst, type));
+		ldapdb_echo_expect(ldapdb, node, version,
+				   dns_fixedname_name(&fname));
 	}
 
 cleanup:
@@ -1097,6 +1197,7 @@ ldapdb_create(isc_mem_t *mctx, dns_name_t *name, dns_dbtype_t type,
 
 	isc_refcount_init(&ldapdb->refs, 1);
 	ldapdb->ldap_inst = driverarg;
+	ISC_LIST_INIT(ldapdb->echo_pending);
 
 	CHECK(dns_db_create(mctx, "rbt", name, dns_dbtype_zone,
 			    dns_rdataclass_in, 0, NULL, &ldapdb->rbtdb));
@@ -18,7 +18,6 @@
 #include "ldap_convert.h"
 #include "ldap_entry.h"
 #include "mldap.h"
-#include "metadb.h"
 #include "str.h"
 #include "util.h"
 #include "zone_register.h"
@@ -141,32 +140,27 @@ ldap_entry_reconstruct(isc_mem_t *mctx, mldapdb_t *mldap, struct berval *uuid,
 	isc_result_t result;
 	ldap_entry_t *entry = NULL;
 	ld_string_t *str = NULL;
-	metadb_node_t *node = NULL;
 
 	CHECK(str_new(mctx, &str));
-	result = mldap_entry_read(mldap, uuid, &node);
-	if (result != ISC_R_SUCCESS) {
-		log_bug("protocol violation: "
-			"attempt to reconstruct non-existing entry");
-		goto cleanup;
-	}
 	CHECK(ldap_entry_init(mctx, &entry));
 
 	entry->uuid = ber_dupbv(NULL, uuid);
 	if (entry->uuid == NULL)
 		CLEANUP_WITH(ISC_R_NOMEMORY);
 
-	CHECK(mldap_class_get(node, &entry->class));
-	if ((entry->class
-	    & (LDAP_ENTRYCLASS_CONFIG | LDAP_ENTRYCLASS_SERVERCONFIG)) == 0)
-		CHECK(mldap_dnsname_get(node, &entry->fqdn, &entry->zone_name));
+	result = mldap_entry_read(mldap, uuid, &entry->class, &entry->fqdn,
+				  &entry->zone_name);
+	if (result != ISC_R_SUCCESS) {
+		log_bug("protocol violation: "
+			"attempt to reconstruct non-existing entry");
+		goto cleanup;
+	}
 
 	*entryp = entry;
 
 cleanup:
 	if (result != ISC_R_SUCCESS)
 		ldap_entry_destroy(&entry);
-	metadb_node_close(&node);
 	str_destroy(&str);
 	return result;
 }
@@ -533,7 +527,7 @@ ldap_entry_getttl(ldap_entry_t *entry, const settings_set_t * settings)
 	return ttl;
 
 cleanup:
-	INSIST(setting_get_uint("default_ttl", settings, &ttl) == ISC_R_SUCCESS);
+	INSIST(setting_get_uint(SETTING_DEFAULT_TTL, settings, &ttl) == ISC_R_SUCCESS);
 	return ttl;
 }
 
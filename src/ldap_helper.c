@@ -9,6 +9,7 @@
 
 #include <dns/dyndb.h>
 #include <dns/diff.h>
+#include <dns/fixedname.h>
 #include <dns/journal.h>
 #include <dns/rbt.h>
 #include <dns/rdata.h>
@@ -52,17 +53,21 @@
 #define LDAP_DEPRECATED 1
 #include <ldap.h>
 #include <limits.h>
+#include <pthread.h>
 #include <regex.h>
 #include <sasl/sasl.h>
 #include <signal.h>
+#include <stdatomic.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <time.h>
 #include <unistd.h>
 #include <netdb.h>
 
 #include "acl.h"
+#include "echo_filter.h"
 #include "empty_zones.h"
 #include "fs.h"
 #include "fwd.h"
@@ -73,9 +78,9 @@
 #include "ldap_helper.h"
 #include "lock.h"
 #include "log.h"
-#include "metadb.h"
 #include "mldap.h"
 #include "semaphore.h"
+#include "server_list.h"
 #include "settings.h"
 #include "str.h"
 #include "syncptr.h"
@@ -86,6 +91,16 @@
 #include "rbt_helper.h"
 #include "fwd_register.h"
 
+/* Delay before the first reconnect attempt, see reconnect_backoff(). */
+#define RECONNECT_BACKOFF_MIN	2 /* seconds */
+/* Number of full resynchronizations which can be done in a row,
+ * see resync_throttle(). */
+#define RESYNC_BURST		2
+
+#define LDAPDB_EVENT_ZONE_ACTIVATE	(LDAPDB_EVENTCLASS + 6)
+#define LDAPDB_EVENT_ZONE_PUBLISH	(LDAPDB_EVENTCLASS + 7)
+#define LDAPDB_EVENT_ZONE_CLEANUP	(LDAPDB_EVENTCLASS + 8)
+
 #define LDAP_OPT_CHECK(r, ...)						\
 	do {								\
 		if ((r) != LDAP_OPT_SUCCESS) {				\
@@ -94,6 +109,7 @@
 		}							\
 	} while (0)
 
+
 #if LIBDNS_VERSION_MAJOR < 1600
 #define dns_fwdtable_find             dns_fwdtable_find2
 #define dns_zone_getserial            dns_zone_getserial2
@@ -104,6 +120,40 @@ typedef dns_name_t       node_name_t;
 typedef const dns_name_t node_name_t;
 #endif
 
+/*
+ * Since BIND 9.18 timer is created without type and interval
+ * and isc_timer_detach() is replaced by isc_timer_destroy().
+ */
+static isc_result_t ATTR_NONNULLS ATTR_CHECKRESULT
+ticker_create(isc_timermgr_t *timermgr, const isc_interval_t *interval,
+	      isc_task_t *task, isc_taskaction_t action, void *arg,
+	      isc_timer_t **timerp)
+{
+#ifdef HAVE_ISC_TIMER_DESTROY
+	isc_result_t result;
+
+	isc_timer_create(timermgr, task, action, arg, timerp);
+	result = isc_timer_reset(*timerp, isc_timertype_ticker, NULL,
+				 interval, false);
+	if (result != ISC_R_SUCCESS)
+		isc_timer_destroy(timerp);
+	return result;
+#else
+	return isc_timer_create(timermgr, isc_timertype_ticker, NULL, interval,
+				task, action, arg, timerp);
+#endif
+}
+
+static void ATTR_NONNULLS
+ticker_destroy(isc_timer_t **timerp)
+{
+#ifdef HAVE_ISC_TIMER_DESTROY
+	isc_timer_destroy(timerp);
+#else
+	isc_timer_detach(timerp);
+#endif
+}
+
 /*
  * LDAP related typedefs and structs.
  */
@@ -119,9 +169,9 @@ typedef const dns_name_t node_name_t;
  *
  * ldap_connection_t structure represents connection to the LDAP database and
  * per-connection specific data. Access is controlled via
- * ldap_connection_t->lock and ldap_pool_t->conn_semaphore. Each read
- * or write access to ldap_connection_t structure (except create/destroy)
- * must acquire the semaphore and the lock.
+ * ldap_connection_t->lock and stack of idle connections in ldap_pool_t.
+ * Each read or write access to ldap_connection_t structure (except
+ * create/destroy) must take the connection from the pool and hold the lock.
  */
 
 typedef struct ldap_connection  ldap_connection_t;
@@ -142,6 +192,23 @@ struct ldap_auth_pair {
 	char *name;	/* String representation used in configuration file */
 };
 
+/*
+ * Instances with shared_sync enabled which have the same LDAP servers,
+ * base, credentials and server_id. Only the first member (leader) runs
+ * syncrepl session and changes received from LDAP are passed to all
+ * members. See sync_share_join().
+ */
+typedef struct sync_share sync_share_t;
+struct sync_share {
+	isc_mem_t			*mctx;
+	char				*key;
+	isc_mutex_t			lock;
+	ISC_LIST(ldap_instance_t)	members;
+	/* New member joined, leader has to restart syncrepl session. */
+	bool				resync;
+	ISC_LINK(sync_share_t)		link;
+};
+
 /* These are typedefed in ldap_helper.h */
 struct ldap_instance {
 	isc_mem_t		*mctx;
@@ -154,17 +221,33 @@ struct ldap_instance {
 
 	/* Pool of LDAP connections */
 	ldap_pool_t		*pool;
+	/* LDAP servers from 'uri' setting, see server_list.c. */
+	server_list_t		*servers;
+	/* Connection used by syncrepl watcher, it is not part of the pool.
+	 * Servers from 'watcher_uri' setting, NULL means 'uri'. */
+	ldap_connection_t	*watcher_conn;
+	server_list_t		*watcher_servers;
 
 	/* Our own list of zones. */
 	zone_register_t		*zone_register;
 	fwd_register_t		*fwd_register;
 
-	/* krb5 kinit mutex */
+	/* Kerberos credentials, created on first GSSAPI bind
+	 * under kinit_lock. */
 	isc_mutex_t		kinit_lock;
+	krb5_tgt_cache_t	*tgt_cache;
 
 	isc_task_t		*task;
 	isc_thread_t		watcher;
 	bool		exiting;
+
+	/* Syncrepl session shared with other instances, protected by
+	 * share->lock. Inactive members are skipped until the leader
+	 * starts a new session for them. */
+	sync_share_t		*share;
+	ISC_LINK(ldap_instance_t) share_link;
+	bool			share_active;
+
 	/* Non-zero if this instance is 'tainted' by an unrecoverable problem. */
 	isc_refcount_t		errors;
 
@@ -176,15 +259,70 @@ struct ldap_instance {
 
 	sync_ctx_t		*sctx;
 	mldapdb_t		*mldapdb;
+
+	/* Syncrepl cookies from the last configuration and data sessions,
+	 * used to resume synchronization after reconnect. */
+	struct berval		sync_cookie_config;
+	struct berval		sync_cookie_data;
+	/* Current session was resumed from a cookie. */
+	bool			sync_resumed;
+	/* LDAP server uses present phase in current session. */
+	bool			sync_present;
+
+	/* Changes written to LDAP by us, see echo_filter.c. */
+	echo_filter_t		*echo_filter;
+
+	/* Pending PTR record changes and reverse zone cache. */
+	sync_ptr_ctx_t		*syncptr;
+
+	/* SOA serials waiting for write back, see ldap_serial_writeback(). */
+	isc_mutex_t		serial_lock;
+	ISC_LIST(zone_handle_t)	serial_pending;
+	isc_timer_t		*serial_timer;
+
+	/* Zones waiting for publication, see publish_zone_defer(). */
+	isc_mutex_t		publish_lock;
+	ISC_LIST(zone_handle_t)	publish_queue;
 };
 
 struct ldap_pool {
 	isc_mem_t		*mctx;
-	/* List of LDAP connections. */
+	ldap_instance_t		*inst;
+	/* List of LDAP connections protected by lock. Arrays conns and idle
+	 * have space for max_connections but only the first 'connections'
+	 * are in use. */
 	unsigned int		connections; /* number of connections */
-	semaphore_t		conn_semaphore;
+	unsigned int		min_connections;
+	unsigned int		max_connections;
 	ldap_connection_t	**conns;
 
+	/* Stack of idle connections protected by lock. The most recently
+	 * returned connection is reused first so its TLS session and
+	 * TCP connection stay warm. The bottom of the stack is the connection
+	 * which is idle for the longest time. */
+	isc_mutex_t		lock;
+	isc_condition_t		cond;
+	ldap_connection_t	**idle;
+	unsigned int		idle_count;
+	unsigned int		waiters; /* callers waiting for connection */
+
+	/* Thread which opens new connections on demand, probes idle
+	 * connections every check_interval seconds and closes connections
+	 * idle for more than idle_timeout seconds. It runs only if
+	 * max_connections > min_connections or check_interval > 0. */
+	isc_thread_t		connector;
+	bool			connector_running;
+	isc_condition_t		connector_cond;
+	uint32_t		idle_timeout;
+	uint32_t		check_interval;
+	isc_time_t		next_grow; /* do not open new connection before */
+	bool			exiting;
+
+	/* Checkout statistics protected by lock. */
+	uint64_t		checkouts;
+	uint64_t		waits;
+	uint64_t		wait_usec_total;
+	uint64_t		wait_usec_max;
 };
 
 struct ldap_connection {
@@ -197,6 +335,16 @@ struct ldap_connection {
 	/* For reconnection logic. */
 	isc_time_t		next_reconnect;
 	unsigned int		tries;
+
+	/* When the connection was returned to the pool. */
+	isc_time_t		last_used;
+	/* When the connection was probed by the connector thread. */
+	isc_time_t		last_check;
+
+	/* Index of server the connection is bound to or SERVER_NONE. */
+	int			server;
+	/* Connection is used by syncrepl watcher. */
+	bool			watcher;
 };
 
 /* Supported authentication types. */
@@ -207,19 +355,26 @@ const ldap_auth_pair_t supported_ldap_auth[] = {
 	{ AUTH_INVALID, NULL		},
 };
 
-extern const settings_set_t settings_default_set;
+extern settings_set_t settings_default_set;
 
 /** Local configuration file */
 static const setting_t settings_local_default[] = {
 	{ "uri",			no_default_string	},
 	{ "connections",		no_default_uint		},
+	{ "connections_max",		no_default_uint		},
+	{ "connections_idle_timeout",	no_default_uint		},
+	{ "connections_check_interval",	no_default_uint		},
 	{ "reconnect_interval",		no_default_uint		},
+	{ "resync_interval",		no_default_uint		},
 	{ "timeout",			no_default_uint		},
 	{ "base",			no_default_string	},
 	{ "auth_method",		no_default_string	},
 	{ "auth_method_enum",		no_default_uint		},
 	{ "bind_dn",			no_default_string	},
 	{ "password",			no_default_string	},
+	{ "watcher_uri",		no_default_string	},
+	{ "watcher_bind_dn",		no_default_string	},
+	{ "watcher_password",		no_default_string	},
 	{ "krb5_principal",		no_default_string	},
 	{ "sasl_mech",			no_default_string	},
 	{ "sasl_user",			no_default_string	},
@@ -229,8 +384,12 @@ static const setting_t settings_local_default[] = {
 	{ "krb5_keytab",		no_default_string	},
 	{ "fake_mname",			no_default_string	},
 	{ "ldap_hostname",		no_default_string	},
+	{ "keepalive_idle",		no_default_uint		},
+	{ "keepalive_probes",		no_default_uint		},
+	{ "keepalive_interval",		no_default_uint		},
 	{ "sync_ptr",			no_default_boolean	},
 	{ "dyn_update",			no_default_boolean	},
+	{ "serial_flush_interval",	no_default_uint		},
 	{ "verbose_checks",		no_default_boolean	},
 	{ "directory",			no_default_string	},
 	{ "nsec3param",			default_string("0 0 0 00")	}, /* NSEC only */
@@ -240,6 +399,7 @@ static const setting_t settings_local_default[] = {
 	{ "forward_policy",		no_default_string	},
 	{ "forwarders",			no_default_string	},
 	{ "server_id",			no_default_string	},
+	{ "shared_sync",		no_default_boolean	},
 	end_of_settings
 };
 
@@ -254,24 +414,36 @@ dyndb_ldap_conf_clauses[] = {
 	{ "base",               &cfg_type_qstring,	0	},
 	{ "bind_dn",            &cfg_type_qstring,	0	},
 	{ "connections",        &cfg_type_uint32,	0	},
+	{ "connections_check_interval", &cfg_type_uint32, 0	},
+	{ "connections_idle_timeout", &cfg_type_uint32,	0	},
+	{ "connections_max",    &cfg_type_uint32,	0	},
 	{ "directory",          &cfg_type_qstring,	0	},
 	{ "dyn_update",         &cfg_type_boolean,	0	},
 	{ "fake_mname",         &cfg_type_qstring,	0	},
+	{ "keepalive_idle",     &cfg_type_uint32,	0	},
+	{ "keepalive_interval", &cfg_type_uint32,	0	},
+	{ "keepalive_probes",   &cfg_type_uint32,	0	},
 	{ "krb5_keytab",        &cfg_type_qstring,	0	},
 	{ "krb5_principal",     &cfg_type_qstring,	0	},
 	{ "ldap_hostname",      &cfg_type_qstring,	0	},
 	{ "password",           &cfg_type_sstring,	0	},
 	{ "reconnect_interval", &cfg_type_uint32,	0	},
+	{ "resync_interval",    &cfg_type_uint32,	0	},
 	{ "sasl_auth_name",     &cfg_type_qstring,	0	},
 	{ "sasl_mech",          &cfg_type_qstring,	0	},
 	{ "sasl_password",      &cfg_type_qstring,	0	},
 	{ "sasl_realm",         &cfg_type_qstring,	0	},
 	{ "sasl_user",          &cfg_type_qstring,	0	},
+	{ "serial_flush_interval", &cfg_type_uint32,	0	},
 	{ "server_id",          &cfg_type_qstring,	0	},
+	{ "shared_sync",        &cfg_type_boolean,	0	},
 	{ "sync_ptr",           &cfg_type_boolean,	0	},
 	{ "timeout",            &cfg_type_uint32,	0	},
 	{ "uri",                &cfg_type_qstring,	0	},
 	{ "verbose_checks",     &cfg_type_boolean,	0	},
+	{ "watcher_bind_dn",    &cfg_type_qstring,	0	},
+	{ "watcher_password",   &cfg_type_sstring,	0	},
+	{ "watcher_uri",        &cfg_type_qstring,	0	},
 	{ NULL,			NULL,			0	}
 };
 
@@ -366,7 +538,9 @@ static isc_result_t modify_ldap_common(dns_name_t *owner, dns_name_t *zone, ldap
 		dns_rdatalist_t *rdlist, int mod_op, bool delete_node) ATTR_NONNULLS ATTR_CHECKRESULT;
 
 /* Functions for maintaining pool of LDAP connections */
-static isc_result_t ldap_pool_create(isc_mem_t *mctx, unsigned int connections,
+static isc_result_t ldap_pool_create(isc_mem_t *mctx,
+		unsigned int min_connections, unsigned int max_connections,
+		uint32_t idle_timeout, uint32_t check_interval,
 		ldap_pool_t **poolp) ATTR_NONNULLS ATTR_CHECKRESULT;
 static void ldap_pool_destroy(ldap_pool_t **poolp);
 static isc_result_t ldap_pool_getconnection(ldap_pool_t *pool,
@@ -375,10 +549,20 @@ static void ldap_pool_putconnection(ldap_pool_t *pool,
 		ldap_connection_t ** conn) ATTR_NONNULLS;
 static isc_result_t ldap_pool_connect(ldap_pool_t *pool,
 		ldap_instance_t *ldap_inst) ATTR_NONNULLS ATTR_CHECKRESULT;
+static isc_threadresult_t
+ldap_pool_connector(isc_threadarg_t arg) ATTR_NONNULLS;
+
+/* Coalesced SOA serial write back */
+static void ldap_serial_flush(isc_task_t *task, isc_event_t *event) ATTR_NONNULLS;
+static void ldap_serial_flush_pending(ldap_instance_t *inst) ATTR_NONNULLS;
 
 /* Persistent updates watcher */
 static isc_threadresult_t
 ldap_syncrepl_watcher(isc_threadarg_t arg) ATTR_NONNULLS ATTR_CHECKRESULT;
+static isc_result_t
+sync_share_join(ldap_instance_t *inst) ATTR_NONNULLS ATTR_CHECKRESULT;
+static void
+sync_share_leave(ldap_instance_t *inst) ATTR_NONNULLS;
 
 static isc_result_t ATTR_NONNULLS ATTR_CHECKRESULT
 zone_master_reconfigure_nsec3param(settings_set_t *zone_settings,
@@ -396,6 +580,7 @@ validate_local_instance_settings(ldap_instance_t *inst, settings_set_t *set) {
 	isc_result_t result;
 
 	uint32_t uint;
+	uint32_t max_connections;
 	const char *sasl_mech = NULL;
 	const char *sasl_user = NULL;
 	const char *sasl_realm = NULL;
@@ -418,7 +603,8 @@ validate_local_instance_settings(ldap_instance_t *inst, settings_set_t *set) {
 
 	/* Use instance name as default working directory */
 	CHECK(str_new(inst->mctx, &buff));
-	CHECK(setting_get_str("directory", inst->local_settings, &dir_name));
+	CHECK(setting_get_str(SETTING_DIRECTORY, inst->local_settings,
+			      &dir_name));
 	dir_default = (strlen(dir_name) == 0);
 	if (dir_default == true) {
 		CHECK(str_cat_char(buff, "dyndb-ldap/"));
@@ -434,25 +620,32 @@ validate_local_instance_settings(ldap_instance_t *inst, settings_set_t *set) {
 				  str_buf(buff)));
 	str_destroy(&buff);
 	dir_name = NULL;
-	CHECK(setting_get_str("directory", inst->local_settings, &dir_name));
+	CHECK(setting_get_str(SETTING_DIRECTORY, inst->local_settings,
+			      &dir_name));
 
 	/* Make sure that working directory exists */
 	CHECK(fs_dirs_create(dir_name));
 
 	/* Set timer for deadlock detection inside semaphore_wait_timed . */
-	CHECK(setting_get_uint("timeout", set, &uint));
+	CHECK(setting_get_uint(SETTING_TIMEOUT, set, &uint));
 	if (conn_wait_timeout.seconds < uint*SEM_WAIT_TIMEOUT_MUL)
 		conn_wait_timeout.seconds = uint*SEM_WAIT_TIMEOUT_MUL;
 
-	CHECK(setting_get_uint("connections", set, &uint));
-	if (uint < 2) {
-		log_error("at least two connections are required");
-		/* watcher needs one and update_*() requests second connection */
+	CHECK(setting_get_uint(SETTING_CONNECTIONS, set, &uint));
+	if (uint < 1) {
+		/* watcher has its own connection outside of the pool */
+		log_error("at least one connection is required");
+		CLEANUP_WITH(ISC_R_RANGE);
+	}
+	CHECK(setting_get_uint(SETTING_CONNECTIONS_MAX, set, &max_connections));
+	if (max_connections != 0 && max_connections < uint) {
+		log_error("connections_max %u is lower than connections %u",
+			  max_connections, uint);
 		CLEANUP_WITH(ISC_R_RANGE);
 	}
 
 	/* Select authentication method. */
-	CHECK(setting_get_str("auth_method", set, &auth_method_str));
+	CHECK(setting_get_str(SETTING_AUTH_METHOD, set, &auth_method_str));
 	auth_method_enum = AUTH_INVALID;
 	for (int i = 0; supported_ldap_auth[i].name != NULL; i++) {
 		if (!strcasecmp(auth_method_str, supported_ldap_auth[i].name)) {
@@ -474,13 +667,13 @@ validate_local_instance_settings(ldap_instance_t *inst, settings_set_t *set) {
 	CHECK(setting_set("auth_method_enum", inst->local_settings, print_buff));
 
 	/* check we have the right data when SASL/GSSAPI is selected */
-	CHECK(setting_get_str("sasl_mech", set, &sasl_mech));
-	CHECK(setting_get_str("krb5_principal", set, &krb5_principal));
-	CHECK(setting_get_str("sasl_user", set, &sasl_user));
-	CHECK(setting_get_str("sasl_realm", set, &sasl_realm));
-	CHECK(setting_get_str("sasl_password", set, &sasl_password));
-	CHECK(setting_get_str("bind_dn", set, &bind_dn));
-	CHECK(setting_get_str("password", set, &password));
+	CHECK(setting_get_str(SETTING_SASL_MECH, set, &sasl_mech));
+	CHECK(setting_get_str(SETTING_KRB5_PRINCIPAL, set, &krb5_principal));
+	CHECK(setting_get_str(SETTING_SASL_USER, set, &sasl_user));
+	CHECK(setting_get_str(SETTING_SASL_REALM, set, &sasl_realm));
+	CHECK(setting_get_str(SETTING_SASL_PASSWORD, set, &sasl_password));
+	CHECK(setting_get_str(SETTING_BIND_DN, set, &bind_dn));
+	CHECK(setting_get_str(SETTING_PASSWORD, set, &password));
 
 	if (auth_method_enum != AUTH_SIMPLE &&
 	   (strlen(bind_dn) != 0 || strlen(password) != 0)) {
@@ -562,9 +755,16 @@ new_ldap_instance(isc_mem_t *mctx, const char *db_name, const char *parameters,
 	isc_buffer_t *forwarders_list = NULL;
 	const char *forward_policy = NULL;
 	uint32_t connections;
+	uint32_t max_connections;
+	uint32_t idle_timeout;
+	uint32_t check_interval;
+	uint32_t serial_flush_interval;
+	isc_interval_t interval;
 	char settings_name[PRINT_BUFF_SIZE];
 	ldap_globalfwd_handleez_t *gfwdevent = NULL;
 	const char *server_id = NULL;
+	const char *uri = NULL;
+	const char *watcher_uri = NULL;
 
 	REQUIRE(ldap_instp != NULL && *ldap_instp == NULL);
 
@@ -651,7 +851,7 @@ new_ldap_instance(isc_mem_t *mctx, const char *db_name, const char *parameters,
 		CLEANUP_WITH(ISC_R_FAILURE);
 
 	/* zero-length server_id means undefined value */
-	CHECK(setting_get_str("server_id", ldap_inst->local_settings,
+	CHECK(setting_get_str(SETTING_SERVER_ID, ldap_inst->local_settings,
 			      &server_id));
 	if (strlen(server_id) == 0) {
 		/* truncation is allowed */
@@ -676,23 +876,69 @@ new_ldap_instance(isc_mem_t *mctx, const char *db_name, const char *parameters,
 			(setting_t *) &settings_fwdz_defaults[0]
 	};
 
-	CHECK(setting_get_uint("connections", ldap_inst->local_settings, &connections));
+	CHECK(setting_get_uint(SETTING_CONNECTIONS, ldap_inst->local_settings,
+			       &connections));
+	CHECK(setting_get_uint(SETTING_CONNECTIONS_MAX, ldap_inst->local_settings,
+			       &max_connections));
+	if (max_connections == 0)
+		max_connections = connections;
+	CHECK(setting_get_uint(SETTING_CONNECTIONS_IDLE_TIMEOUT,
+			       ldap_inst->local_settings, &idle_timeout));
+	CHECK(setting_get_uint(SETTING_CONNECTIONS_CHECK_INTERVAL,
+			       ldap_inst->local_settings, &check_interval));
 
 	CHECK(zr_create(mctx, ldap_inst, ldap_inst->server_ldap_settings,
 			&ldap_inst->zone_register));
+	CHECK(sync_ptr_ctx_create(mctx, ldap_inst->zone_register,
+				  &ldap_inst->syncptr));
 	CHECK(fwdr_create(ldap_inst->mctx, &ldap_inst->fwd_register));
 	CHECK(mldap_new(mctx, &ldap_inst->mldapdb));
+	CHECK(echo_filter_create(mctx, &ldap_inst->echo_filter));
 
 	/* isc_mutex_init and isc_condition_init failures are now fatal */
 	isc_mutex_init(&ldap_inst->kinit_lock);
+	isc_mutex_init(&ldap_inst->serial_lock);
+	ISC_LIST_INIT(ldap_inst->serial_pending);
+	isc_mutex_init(&ldap_inst->publish_lock);
+	ISC_LIST_INIT(ldap_inst->publish_queue);
+
+	CHECK(setting_get_uint(SETTING_SERIAL_FLUSH_INTERVAL,
+			       ldap_inst->local_settings,
+			       &serial_flush_interval));
+	if (serial_flush_interval > 0) {
+		isc_interval_set(&interval, serial_flush_interval, 0);
+		CHECK(ticker_create(dctx->timermgr, &interval,
+				    ldap_inst->task, ldap_serial_flush,
+				    ldap_inst, &ldap_inst->serial_timer));
+	}
 
-	CHECK(ldap_pool_create(mctx, connections, &ldap_inst->pool));
+	CHECK(setting_get_str(SETTING_URI, ldap_inst->local_settings, &uri));
+	CHECK(server_list_create(mctx, uri, &ldap_inst->servers));
+	CHECK(ldap_pool_create(mctx, connections, max_connections, idle_timeout,
+			       check_interval, &ldap_inst->pool));
 	CHECK(ldap_pool_connect(ldap_inst->pool, ldap_inst));
 
+	CHECK(setting_get_str(SETTING_WATCHER_URI, ldap_inst->local_settings,
+			      &watcher_uri));
+	if (strlen(watcher_uri) > 0)
+		CHECK(server_list_create(mctx, watcher_uri,
+					 &ldap_inst->watcher_servers));
+	CHECK(new_ldap_connection(ldap_inst->pool, &ldap_inst->watcher_conn));
+	ldap_inst->watcher_conn->watcher = true;
+	result = bdl_ldap_connect(ldap_inst, ldap_inst->watcher_conn, false);
+	/* Continue even if LDAP server is down */
+	if (result != ISC_R_NOTCONNECTED && result != ISC_R_TIMEDOUT &&
+	    result != ISC_R_SUCCESS) {
+		log_error_r("couldn't establish LDAP connection for syncrepl");
+		goto cleanup;
+	}
+
 	/* Register new DNS DB implementation. */
 	CHECK(dns_db_register(ldap_inst->db_name, &ldapdb_associate, ldap_inst,
 			      mctx, &ldap_inst->db_imp));
 
+	CHECK(sync_share_join(ldap_inst));
+
 	/* Start the watcher thread */
 	/* isc_thread_create assert internally on failure */
 	isc_thread_create(ldap_syncrepl_watcher, ldap_inst,
@@ -717,6 +963,20 @@ cleanup:
 }
 #undef PRINT_BUFF_SIZE
 
+/**
+ * Forget syncrepl cookies so the next session does full refresh.
+ */
+static void ATTR_NONNULLS
+ldap_sync_cookies_clear(ldap_instance_t *inst)
+{
+	if (inst->sync_cookie_config.bv_val != NULL)
+		ldap_memfree(inst->sync_cookie_config.bv_val);
+	BER_BVZERO(&inst->sync_cookie_config);
+	if (inst->sync_cookie_data.bv_val != NULL)
+		ldap_memfree(inst->sync_cookie_data.bv_val);
+	BER_BVZERO(&inst->sync_cookie_data);
+}
+
 /**
  * Send SIGUSR1 to the SyncRepl watcher thread and wait for it to terminate.
  *
@@ -753,6 +1013,7 @@ void
 destroy_ldap_instance(ldap_instance_t **ldap_instp)
 {
 	ldap_instance_t *ldap_inst;
+	zone_handle_t *zone;
 
 	REQUIRE(ldap_instp != NULL);
 
@@ -764,13 +1025,31 @@ destroy_ldap_instance(ldap_instance_t **ldap_instp)
 		ldap_syncrepl_watcher_shutdown(ldap_inst);
 		ldap_inst->watcher = 0;
 	}
+	/* Exiting instance is skipped by leader of shared syncrepl session. */
+	sync_share_leave(ldap_inst);
+
+	/* Pending serials are written using zone register. */
+	if (ldap_inst->serial_timer != NULL)
+		ticker_destroy(&ldap_inst->serial_timer);
+	if (ldap_inst->pool != NULL)
+		ldap_serial_flush_pending(ldap_inst);
+
+	while ((zone = HEAD(ldap_inst->publish_queue)) != NULL) {
+		ISC_LIST_UNLINK(ldap_inst->publish_queue, zone, publish_link);
+		zone_handle_detach(&zone);
+	}
 
+	sync_ptr_ctx_destroy(&ldap_inst->syncptr);
 	/* Unregister all zones already registered in BIND. */
 	zr_destroy(&ldap_inst->zone_register);
 	fwdr_destroy(&ldap_inst->fwd_register);
 	mldap_destroy(&ldap_inst->mldapdb);
+	echo_filter_destroy(&ldap_inst->echo_filter);
 
+	destroy_ldap_connection(&ldap_inst->watcher_conn);
 	ldap_pool_destroy(&ldap_inst->pool);
+	server_list_destroy(&ldap_inst->watcher_servers);
+	server_list_destroy(&ldap_inst->servers);
 	if (ldap_inst->db_imp != NULL)
 		dns_db_unregister(&ldap_inst->db_imp);
 	if (ldap_inst->view != NULL)
@@ -780,8 +1059,13 @@ destroy_ldap_instance(ldap_instance_t **ldap_instp)
 	if (ldap_inst->task != NULL)
 		isc_task_detach(&ldap_inst->task);
 
+	krb5_tgt_cache_destroy(&ldap_inst->tgt_cache);
+	ldap_sync_cookies_clear(ldap_inst);
+
 	/* isc_mutex_init and isc_condition_init failures are now fatal */
 	isc_mutex_destroy(&ldap_inst->kinit_lock);
+	isc_mutex_destroy(&ldap_inst->serial_lock);
+	isc_mutex_destroy(&ldap_inst->publish_lock);
 
 	settings_set_free(&ldap_inst->global_settings);
 	settings_set_free(&ldap_inst->local_settings);
@@ -823,6 +1107,7 @@ new_ldap_connection(ldap_pool_t *pool, ldap_connection_t **ldap_connp)
 	 */
 
 	isc_mem_attach(pool->mctx, &ldap_conn->mctx);
+	ldap_conn->server = SERVER_NONE;
 
 	*ldap_connp = ldap_conn;
 
@@ -897,27 +1182,75 @@ cleanup:
 	return result;
 }
 
+typedef struct zone_cleanupev zone_cleanupev_t;
+struct zone_cleanupev {
+	ISC_EVENT_COMMON(zone_cleanupev_t);
+	zone_handle_t			*zone;
+};
+
+/**
+ * Remove files of zone marked as stale by cleanup_files() unless
+ * they were removed already.
+ *
+ * @pre Called from task of the zone or in task-exclusive mode.
+ */
+static void ATTR_NONNULLS
+cleanup_stale_files(zone_handle_t *zone)
+{
+	if (atomic_exchange(&zone->files_stale, false) == false)
+		return;
+
+	/* Files of raw part of in-line secure zone are removed
+	 * together with files of the secure zone.
+	 * Failure is logged by cleanup_zone_files(). */
+	(void)cleanup_zone_files((zone->secure != NULL) ? zone->secure
+							: zone->raw);
+}
+
+static void ATTR_NONNULLS
+cleanup_stale_files_action(isc_task_t *task, isc_event_t *event)
+{
+	zone_cleanupev_t *cev = (zone_cleanupev_t *)event;
+
+	UNUSED(task);
+
+	cleanup_stale_files(cev->zone);
+	zone_handle_detach(&cev->zone);
+	isc_event_free(&event);
+}
+
 /**
  * Remove zone files and journal files associated with all zones in ZR.
+ *
+ * Zones are only marked as stale and files are removed in background
+ * by tasks of the zones, so start of synchronization is not delayed
+ * by thousands of unlink() calls. Records are applied in the same tasks
+ * after the files are removed. Journal write in update_zone() removes
+ * the files first if the task of the zone did not get to it yet.
+ * Files of zones created later are removed by create_zone().
  */
 static isc_result_t ATTR_CHECKRESULT
 cleanup_files(ldap_instance_t *inst) {
 	isc_result_t result;
 	rbt_iterator_t *iter = NULL;
-	dns_zone_t *raw = NULL;
-	dns_zone_t *secure = NULL;
+	zone_handle_t *zone = NULL;
+	zone_cleanupev_t *cev = NULL;
+	unsigned int count = 0;
 	DECLARE_BUFFERED_NAME(name);
 
 	INIT_BUFFERED_NAME(name);
 	CHECK(zr_rbt_iter_init(inst->zone_register, &iter, &name));
 	do {
-		CHECK(zr_get_zone_ptr(inst->zone_register, &name, &raw, &secure));
-		cleanup_zone_files(raw);
-		dns_zone_detach(&raw);
-		if (secure != NULL) {
-			cleanup_zone_files(secure);
-			dns_zone_detach(&secure);
-		}
+		CHECK(zr_get_zone_handle(inst->zone_register, &name, &zone));
+		atomic_store(&zone->files_stale, true);
+		cev = (zone_cleanupev_t *)isc_event_allocate(inst->mctx, inst,
+					LDAPDB_EVENT_ZONE_CLEANUP,
+					cleanup_stale_files_action, NULL,
+					sizeof(*cev));
+		cev->zone = zone;
+		zone = NULL;
+		isc_task_send(cev->zone->task, (isc_event_t **)&cev);
+		count++;
 
 		INIT_BUFFERED_NAME(name);
 		CHECK(rbt_iter_next(&iter, &name));
@@ -926,6 +1259,9 @@ cleanup_files(ldap_instance_t *inst) {
 cleanup:
 	if (result == ISC_R_NOTFOUND || result == ISC_R_NOMORE)
 		result = ISC_R_SUCCESS;
+	if (count > 0)
+		log_debug(1, "removing files of %u zones of instance '%s' "
+			  "in background", count, inst->db_name);
 	return result;
 }
 
@@ -1133,21 +1469,21 @@ cleanup:
 }
 
 /**
- * Add zone to the view defined in inst->view.
+ * Check if zone can be added to the view defined in inst->view.
+ *
+ * @retval ISC_R_SUCCESS Zone has to be added to the view.
+ * @retval ISC_R_EXISTS  Zone is already published in the right view.
  */
 static isc_result_t ATTR_NONNULLS ATTR_CHECKRESULT
-publish_zone(ldap_instance_t *inst, dns_zone_t *zone)
+publish_zone_check(ldap_instance_t *inst, dns_zone_t *zone)
 {
 	isc_result_t result;
-	bool freeze = false;
 	dns_zone_t *zone_in_view = NULL;
 	dns_view_t *view_in_zone = NULL;
-	isc_result_t lock_state = ISC_R_IGNORE;
 
 	REQUIRE(inst != NULL);
 	REQUIRE(zone != NULL);
 
-	/* Return success if the zone is already in the view as expected. */
 	result = dns_view_findzone(inst->view, dns_zone_getorigin(zone),
 				   &zone_in_view);
 	if (result != ISC_R_SUCCESS && result != ISC_R_NOTFOUND)
@@ -1158,7 +1494,7 @@ publish_zone(ldap_instance_t *inst, dns_zone_t *zone)
 		/* Zone has a view set -> view should contain the same zone. */
 		if (zone_in_view == zone) {
 			/* Zone is already published in the right view. */
-			CLEANUP_WITH(ISC_R_SUCCESS);
+			CLEANUP_WITH(ISC_R_EXISTS);
 		} else if (view_in_zone != inst->view) {
 			/* Un-published inactive zone will have
 			 * inst->view in zone but will not be present
@@ -1175,6 +1511,40 @@ publish_zone(ldap_instance_t *inst, dns_zone_t *zone)
 	} /* else if (zone_in_view == NULL &&
 		      (view_in_zone == NULL || view_in_zone == inst->view))
 	     Publish the zone. */
+	result = ISC_R_SUCCESS;
+
+cleanup:
+	if (zone_in_view != NULL)
+		dns_zone_detach(&zone_in_view);
+
+	return result;
+}
+
+/**
+ * Add zones to the view defined in inst->view. All zones are added
+ * within a single exclusive section and a single view thaw/freeze cycle
+ * so the rest of the server is stopped only once.
+ *
+ * @param[in]  zones   Array of zones to publish.
+ * @param[out] results Result of publication for each zone.
+ *                     ISC_R_SUCCESS if the zone is in the view.
+ */
+static void ATTR_NONNULLS
+publish_zones(ldap_instance_t *inst, dns_zone_t **zones,
+	      isc_result_t *results, unsigned int count)
+{
+	bool freeze = false;
+	bool needed = false;
+	isc_result_t lock_state = ISC_R_IGNORE;
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		results[i] = publish_zone_check(inst, zones[i]);
+		if (results[i] == ISC_R_SUCCESS)
+			needed = true;
+	}
+	if (needed == false)
+		goto cleanup;
 
 	run_exclusive_enter(inst, &lock_state);
 	if (inst->view->frozen) {
@@ -1182,111 +1552,333 @@ publish_zone(ldap_instance_t *inst, dns_zone_t *zone)
 		dns_view_thaw(inst->view);
 	}
 
-	dns_zone_setview(zone, inst->view);
-	CHECK(dns_view_addzone(inst->view, zone));
+	for (i = 0; i < count; i++) {
+		if (results[i] != ISC_R_SUCCESS)
+			continue;
+		dns_zone_setview(zones[i], inst->view);
+		results[i] = dns_view_addzone(inst->view, zones[i]);
+	}
+	zr_bump_generation(inst->zone_register);
 
-cleanup:
-	if (zone_in_view != NULL)
-		dns_zone_detach(&zone_in_view);
 	if (freeze)
 		dns_view_freeze(inst->view);
 	run_exclusive_exit(inst, lock_state);
 
-	return result;
+cleanup:
+	/* Zone was already published in the right view. */
+	for (i = 0; i < count; i++)
+		if (results[i] == ISC_R_EXISTS)
+			results[i] = ISC_R_SUCCESS;
 }
 
 /**
- * Add zone to view and call dns_zone_load().
+ * Queue new or re-activated zone for publication in the view.
+ *
+ * Zones created by a burst of LDAP changes are published together
+ * by publish_pending_zones() so the server is stopped once per burst
+ * and not once per zone.
  */
 static isc_result_t ATTR_NONNULLS ATTR_CHECKRESULT
-activate_zone(ldap_instance_t *inst, dns_name_t *name) {
+publish_zone_defer(ldap_instance_t *inst, dns_name_t *name)
+{
 	isc_result_t result;
-	dns_zone_t *raw = NULL;
-	dns_zone_t *secure = NULL;
-	dns_zone_t *toview = NULL;
-	settings_set_t *zone_settings = NULL;
+	zone_handle_t *zone = NULL;
 
-	CHECK(zr_get_zone_ptr(inst->zone_register, name, &raw, &secure));
+	CHECK(zr_get_zone_handle(inst->zone_register, name, &zone));
 
-	/* Load only "secure" zone if inline-signing is active.
-	 * It will not work if raw zone is loaded explicitly
-	 * - dns_zone_load() will fail magically. */
-	toview = (secure != NULL) ? secure : raw;
+	LOCK(&inst->publish_lock);
+	if (!ISC_LINK_LINKED(zone, publish_link)) {
+		/* The queue owns the reference. */
+		ISC_LIST_APPEND(inst->publish_queue, zone, publish_link);
+		zone = NULL;
+	}
+	UNLOCK(&inst->publish_lock);
 
-	/*
-	 * Zone has to be published *before* zone load
-	 * otherwise it will race with zone->view != NULL check
-	 * in zone_maintenance() in zone.c.
-	 */
-	result = publish_zone(inst, toview);
-	if (result != ISC_R_SUCCESS) {
-		dns_zone_log(toview, ISC_LOG_ERROR,
-			     "cannot add zone to view: %s",
-			     dns_result_totext(result));
+cleanup:
+	zone_handle_detach(&zone);
+	return result;
+}
+
+/**
+ * @retval true Zone is waiting for publication in publish queue.
+ */
+static bool ATTR_NONNULLS ATTR_CHECKRESULT
+publish_zone_ispending(ldap_instance_t *inst, zone_handle_t *zone)
+{
+	bool pending;
+
+	LOCK(&inst->publish_lock);
+	pending = ISC_LINK_LINKED(zone, publish_link);
+	UNLOCK(&inst->publish_lock);
+
+	return pending;
+}
+
+/**
+ * Publish all zones queued by publish_zone_defer() in a single exclusive
+ * section, load them and configure forwarding for them.
+ * Zones which were deleted or deactivated in the meantime are skipped.
+ *
+ * The publish lock is held until the zones are loaded so records for
+ * queued zones cannot be applied to zones which are not loaded yet,
+ * see syncrepl_update().
+ *
+ * @pre Called from inst->task.
+ */
+static void ATTR_NONNULLS
+publish_pending_zones(ldap_instance_t *inst)
+{
+	isc_result_t result;
+	zone_handle_t *zone;
+	zone_handle_t **handles = NULL;
+	dns_zone_t **zones = NULL;
+	isc_result_t *results = NULL;
+	unsigned int queued = 0;
+	unsigned int count = 0;
+	unsigned int i;
+	bool active;
+
+	LOCK(&inst->publish_lock);
+	for (zone = HEAD(inst->publish_queue);
+	     zone != NULL;
+	     zone = NEXT(zone, publish_link))
+		queued++;
+	if (queued == 0)
 		goto cleanup;
+
+	handles = isc_mem_get(inst->mctx, queued * sizeof(*handles));
+	zones = isc_mem_get(inst->mctx, queued * sizeof(*zones));
+	results = isc_mem_get(inst->mctx, queued * sizeof(*results));
+	for (zone = HEAD(inst->publish_queue);
+	     zone != NULL;
+	     zone = NEXT(zone, publish_link)) {
+		if (zone->removed == true)
+			continue;
+		result = setting_get_bool(SETTING_ACTIVE, zone->settings,
+					  &active);
+		if (result != ISC_R_SUCCESS || active == false)
+			continue;
+		handles[count] = zone;
+		zones[count] = (zone->secure != NULL) ? zone->secure
+						      : zone->raw;
+		count++;
 	}
+	log_debug(1, "publishing %u zones", count);
 
-	CHECK(load_zone(toview, true));
-	if (secure != NULL) {
-		CHECK(zr_get_zone_settings(inst->zone_register, name,
-					   &zone_settings));
-		CHECK(zone_master_reconfigure_nsec3param(zone_settings,
-							 secure));
+	publish_zones(inst, zones, results, count);
+	for (i = 0; i < count; i++) {
+		result = results[i];
+		if (result == ISC_R_SUCCESS)
+			result = load_zone(zones[i], false);
+		if (result == ISC_R_SUCCESS)
+			result = fwd_configure_zone(handles[i]->settings, inst,
+						    dns_zone_getorigin(zones[i]));
+		if (result != ISC_R_SUCCESS)
+			dns_zone_log(zones[i], ISC_LOG_ERROR,
+				     "zone publication failed: %s",
+				     dns_result_totext(result));
+	}
+
+	while ((zone = HEAD(inst->publish_queue)) != NULL) {
+		ISC_LIST_UNLINK(inst->publish_queue, zone, publish_link);
+		zone_handle_detach(&zone);
 	}
 
 cleanup:
-	if (raw != NULL)
-		dns_zone_detach(&raw);
-	if (secure != NULL)
-		dns_zone_detach(&secure);
-	return result;
+	UNLOCK(&inst->publish_lock);
+	if (handles != NULL)
+		isc_mem_put(inst->mctx, handles, queued * sizeof(*handles));
+	if (zones != NULL)
+		isc_mem_put(inst->mctx, zones, queued * sizeof(*zones));
+	if (results != NULL)
+		isc_mem_put(inst->mctx, results, queued * sizeof(*results));
+}
+
+/**
+ * Shared state of zone activation after initial synchronization.
+ * Zones are loaded concurrently in their own tasks, the last one
+ * reports the result.
+ */
+typedef struct zone_activation {
+	isc_mem_t		*mctx;
+	char			*db_name;
+	isc_time_t		start;
+	atomic_uint_fast32_t	pending;  /* zones being loaded + 1 */
+	atomic_uint_fast32_t	loaded;
+	unsigned int		total_cnt;
+	unsigned int		active_cnt;
+} zone_activation_t;
+
+typedef struct zone_activateev zone_activateev_t;
+struct zone_activateev {
+	ISC_EVENT_COMMON(zone_activateev_t);
+	zone_activation_t		*activation;
+	zone_handle_t			*zone;
+	ISC_LINK(zone_activateev_t)	link;
+};
+
+/**
+ * Release zone activation. Result is logged when all zones were loaded.
+ */
+static void ATTR_NONNULLS
+zone_activation_done(zone_activation_t **activationp)
+{
+	zone_activation_t *activation = *activationp;
+	unsigned int published_cnt;
+	isc_time_t now;
+	uint64_t msec = 0;
+
+	*activationp = NULL;
+	if (atomic_fetch_sub(&activation->pending, 1) != 1)
+		return;
+
+	if (isc_time_now(&now) == ISC_R_SUCCESS)
+		msec = isc_time_microdiff(&now, &activation->start) / 1000;
+	published_cnt = atomic_load(&activation->loaded);
+	log_info("%u master zones from LDAP instance '%s' loaded (%u zones "
+		 "defined, %u inactive, %u failed to load) in %" PRIu64 " ms",
+		 published_cnt, activation->db_name, activation->total_cnt,
+		 activation->total_cnt - activation->active_cnt,
+		 activation->active_cnt - published_cnt, msec);
+	if (activation->total_cnt < 1)
+		log_info("0 master zones is suspicious number, please check "
+			 "access control instructions on LDAP server");
+
+	isc_mem_free(activation->mctx, activation->db_name);
+	MEM_PUT_AND_DETACH(activation);
+}
+
+/**
+ * Load zone published by activate_zones(). Runs in task of the raw zone
+ * so zones are loaded in parallel.
+ */
+static void ATTR_NONNULLS
+activate_zone(isc_task_t *task, isc_event_t *event)
+{
+	zone_activateev_t *aev = (zone_activateev_t *)event;
+	zone_handle_t *zone = aev->zone;
+	isc_result_t result;
+
+	UNUSED(task);
+
+	/* Load only "secure" zone if inline-signing is active.
+	 * It will not work if raw zone is loaded explicitly
+	 * - dns_zone_load() will fail magically. */
+	CHECK(load_zone((zone->secure != NULL) ? zone->secure : zone->raw,
+			true));
+	if (zone->secure != NULL)
+		CHECK(zone_master_reconfigure_nsec3param(zone->settings,
+							 zone->secure));
+	atomic_fetch_add(&aev->activation->loaded, 1);
+
+cleanup:
+	zone_handle_detach(&aev->zone);
+	zone_activation_done(&aev->activation);
+	isc_event_free(&event);
 }
 
 /**
  * Add all active zones in zone register to DNS view specified in inst->view
  * and load zones.
+ *
+ * All zones are published at once, see publish_zones(). Zone has to be
+ * published *before* zone load otherwise it will race with
+ * zone->view != NULL check in zone_maintenance() in zone.c.
+ * Zones are then loaded concurrently in tasks of the zones.
  */
 isc_result_t
 activate_zones(ldap_instance_t *inst) {
 	isc_result_t result;
 	rbt_iterator_t *iter = NULL;
 	DECLARE_BUFFERED_NAME(name);
-	unsigned int published_cnt = 0;
-	unsigned int total_cnt = 0;
-	unsigned int active_cnt = 0;
-	settings_set_t *settings;
+	zone_activation_t *activation = NULL;
+	ISC_LIST(zone_activateev_t) events;
+	zone_activateev_t *aev = NULL;
+	zone_handle_t *zone = NULL;
+	dns_zone_t **zones = NULL;
+	isc_result_t *results = NULL;
+	unsigned int i;
 	bool active;
 
+	ISC_LIST_INIT(events);
+	activation = isc_mem_get(inst->mctx, sizeof(*activation));
+	ZERO_PTR(activation);
+	isc_mem_attach(inst->mctx, &activation->mctx);
+	activation->db_name = isc_mem_strdup(inst->mctx, inst->db_name);
+	if (isc_time_now(&activation->start) != ISC_R_SUCCESS)
+		isc_time_settoepoch(&activation->start);
+	atomic_init(&activation->pending, 1);
+	atomic_init(&activation->loaded, 0);
+
 	INIT_BUFFERED_NAME(name);
 	for(result = zr_rbt_iter_init(inst->zone_register, &iter, &name);
 	    result == ISC_R_SUCCESS;
 	    dns_name_reset(&name), result = rbt_iter_next(&iter, &name)) {
-		settings = NULL;
-		result = zr_get_zone_settings(inst->zone_register, &name, &settings);
+		result = zr_get_zone_handle(inst->zone_register, &name, &zone);
 		INSIST(result == ISC_R_SUCCESS);
-		result = setting_get_bool("active", settings, &active);
+		result = setting_get_bool(SETTING_ACTIVE, zone->settings,
+					  &active);
 		INSIST(result == ISC_R_SUCCESS);
 
-		++total_cnt;
+		++activation->total_cnt;
 		if (active == true) {
-			++active_cnt;
-			result = activate_zone(inst, &name);
-			if (result == ISC_R_SUCCESS)
-				++published_cnt;
-			result = fwd_configure_zone(settings, inst, &name);
+			++activation->active_cnt;
+			aev = (zone_activateev_t *)isc_event_allocate(
+					inst->mctx, inst,
+					LDAPDB_EVENT_ZONE_ACTIVATE,
+					activate_zone, NULL, sizeof(*aev));
+			aev->activation = NULL;
+			aev->zone = zone;
+			zone = NULL;
+			ISC_LINK_INIT(aev, link);
+			ISC_LIST_APPEND(events, aev, link);
+
+			result = fwd_configure_zone(aev->zone->settings, inst,
+						    &name);
 			if (result != ISC_R_SUCCESS)
 				log_error_r("could not configure forwarding");
-
 		}
+		zone_handle_detach(&zone);
 	};
 
-	log_info("%u master zones from LDAP instance '%s' loaded (%u zones "
-		 "defined, %u inactive, %u failed to load)", published_cnt,
-		 inst->db_name, total_cnt, total_cnt - active_cnt,
-		 active_cnt - published_cnt);
-	if (total_cnt < 1)
-		log_info("0 master zones is suspicious number, please check "
-			 "access control instructions on LDAP server");
+	if (activation->active_cnt > 0) {
+		zones = isc_mem_get(inst->mctx,
+				    activation->active_cnt * sizeof(*zones));
+		results = isc_mem_get(inst->mctx,
+				      activation->active_cnt * sizeof(*results));
+		for (i = 0, aev = ISC_LIST_HEAD(events);
+		     aev != NULL;
+		     i++, aev = ISC_LIST_NEXT(aev, link))
+			zones[i] = (aev->zone->secure != NULL)
+				   ? aev->zone->secure : aev->zone->raw;
+		publish_zones(inst, zones, results, activation->active_cnt);
+	}
+
+	for (i = 0; (aev = ISC_LIST_HEAD(events)) != NULL; i++) {
+		ISC_LIST_UNLINK(events, aev, link);
+		if (results[i] != ISC_R_SUCCESS) {
+			dns_zone_log(zones[i], ISC_LOG_ERROR,
+				     "cannot add zone to view: %s",
+				     dns_result_totext(results[i]));
+			zone_handle_detach(&aev->zone);
+			isc_event_free((isc_event_t **)&aev);
+			continue;
+		}
+		atomic_fetch_add(&activation->pending, 1);
+		aev->activation = activation;
+		/* Task of the raw zone orders the load with record
+		 * updates and file cleanup of the zone. */
+		isc_task_send(aev->zone->task, (isc_event_t **)&aev);
+	}
+
+	if (zones != NULL)
+		isc_mem_put(inst->mctx, zones,
+			    activation->active_cnt * sizeof(*zones));
+	if (results != NULL)
+		isc_mem_put(inst->mctx, results,
+			    activation->active_cnt * sizeof(*results));
+	zone_activation_done(&activation);
+
 	return result;
 }
 
@@ -1434,7 +2026,7 @@ cleanup:
 
 /**
  * Remove zone from view but let the zone object intact. The same zone object
- * can be re-published later using publish_zone().
+ * can be re-published later using publish_zone_defer().
  *
  * @warning
  * This function removes zone from view but the zone->view pointer will stay
@@ -1463,6 +2055,7 @@ unpublish_zone(ldap_instance_t *inst, dns_name_t *name, const char *logname) {
 	/* simulate no explicit forwarding configuration */
 	CHECK(fwd_configure_zone(&inst->empty_fwdz_settings, inst, name));
 	CHECK(dns_zt_unmount(inst->view->zonetable, zone_in_view));
+	zr_bump_generation(inst->zone_register);
 
 cleanup:
 	if (freeze)
@@ -1748,7 +2341,7 @@ ldap_replace_serial(ldap_instance_t *inst, dns_name_t *zone,
 	REQUIRE(inst != NULL);
 
 	CHECK(str_new(inst->mctx, &dn));
-	CHECK(dnsname_to_dn(inst->zone_register, zone, zone, dn));
+	CHECK(dnsname_to_dn(inst->zone_register, zone, zone, dn, NULL));
 
 	change.mod_op = LDAP_MOD_REPLACE;
 	change.mod_type = "idnsSOAserial";
@@ -1766,6 +2359,89 @@ cleanup:
 #undef MAX_SERIAL_LENGTH
 }
 
+/**
+ * Write SOA serial for given zone back to LDAP.
+ *
+ * If serial_flush_interval is set, the serial is only remembered
+ * and written by ldap_serial_flush() later. Consecutive serials for the same
+ * zone collapse into the latest one so busy zones do not generate
+ * an LDAP write for each change.
+ */
+static isc_result_t ATTR_NONNULLS ATTR_CHECKRESULT
+ldap_serial_writeback(ldap_instance_t *inst, dns_name_t *name,
+		      uint32_t serial) {
+	zone_handle_t *zone = NULL;
+
+	if (inst->serial_timer == NULL ||
+	    zr_get_zone_handle(inst->zone_register, name, &zone)
+	    != ISC_R_SUCCESS)
+		return ldap_replace_serial(inst, name, serial);
+
+	LOCK(&inst->serial_lock);
+	if (!ISC_LINK_LINKED(zone, serial_link)) {
+		/* The list owns the reference. */
+		ISC_LIST_APPEND(inst->serial_pending, zone, serial_link);
+		zone->serial = serial;
+		zone = NULL;
+	} else {
+		zone->serial = serial;
+	}
+	UNLOCK(&inst->serial_lock);
+
+	zone_handle_detach(&zone);
+	return ISC_R_SUCCESS;
+}
+
+/**
+ * Write all pending SOA serials to LDAP.
+ */
+static void
+ldap_serial_flush_pending(ldap_instance_t *inst) {
+	isc_result_t result;
+	ISC_LIST(zone_handle_t) pending;
+	zone_handle_t *zone;
+	uint32_t serial = 0;
+
+	LOCK(&inst->serial_lock);
+	pending = inst->serial_pending;
+	ISC_LIST_INIT(inst->serial_pending);
+	UNLOCK(&inst->serial_lock);
+
+	for (;;) {
+		/* Serial can be changed until the zone leaves the list. */
+		LOCK(&inst->serial_lock);
+		zone = HEAD(pending);
+		if (zone != NULL) {
+			ISC_LIST_UNLINK(pending, zone, serial_link);
+			serial = zone->serial;
+		}
+		UNLOCK(&inst->serial_lock);
+		if (zone == NULL)
+			break;
+
+		if (zone->removed == false) {
+			result = ldap_replace_serial(inst,
+						     dns_zone_getorigin(zone->raw),
+						     serial);
+			if (result != ISC_R_SUCCESS)
+				dns_zone_log(zone->raw, ISC_LOG_ERROR,
+					     "serial (%u) write back to LDAP "
+					     "failed", serial);
+		}
+		zone_handle_detach(&zone);
+	}
+}
+
+static void
+ldap_serial_flush(isc_task_t *task, isc_event_t *event) {
+	ldap_instance_t *inst = event->ev_arg;
+
+	UNUSED(task);
+
+	isc_event_free(&event);
+	ldap_serial_flush_pending(inst);
+}
+
 static isc_result_t ATTR_NONNULLS ATTR_CHECKRESULT
 zone_master_reconfigure_nsec3param(settings_set_t *zone_settings,
 				   dns_zone_t *secure) {
@@ -1783,7 +2459,7 @@ zone_master_reconfigure_nsec3param(settings_set_t *zone_settings,
 	origin = dns_zone_getorigin(secure);
 	CHECK(ldap_entry_init(mctx, &fake_entry));
 
-	CHECK(setting_get_str("nsec3param", zone_settings, &nsec3p_str));
+	CHECK(setting_get_str(SETTING_NSEC3PARAM, zone_settings, &nsec3p_str));
 	dns_zone_log(secure, ISC_LOG_INFO,
 		     "reconfiguring NSEC3PARAM to '%s'", nsec3p_str);
 	CHECK(parse_rdata(mctx, fake_entry, dns_rdataclass_in,
@@ -1812,6 +2488,22 @@ cleanup:
 	return result;
 }
 
+/**
+ * Forget value of a zone setting which was stored but not applied,
+ * so the next update of the zone object is treated as a change
+ * and the configuration is applied again.
+ */
+static void ATTR_NONNULLS
+zone_setting_retry(settings_set_t *zone_settings, const char *name)
+{
+	isc_result_t result;
+
+	result = setting_unset(name, zone_settings);
+	if (result != ISC_R_SUCCESS && result != ISC_R_IGNORE)
+		log_error_r("cannot reset setting '%s' in set '%s'", name,
+			    zone_settings->name);
+}
+
 /**
  * Reconfigure master zone according to configuration in LDAP object.
  *
@@ -1826,6 +2518,7 @@ zone_master_reconfigure(ldap_entry_t *entry, settings_set_t *zone_settings,
 	isc_mem_t *mctx = NULL;
 	bool ssu_changed;
 	dns_zone_t *inview = NULL;
+	const char *acl_setting = NULL;
 
 	REQUIRE(entry != NULL);
 	REQUIRE(zone_settings != NULL);
@@ -1866,10 +2559,11 @@ zone_master_reconfigure(ldap_entry_t *entry, settings_set_t *zone_settings,
 		bool ssu_enabled;
 		const char *ssu_policy = NULL;
 
-		CHECK(setting_get_bool("dyn_update", zone_settings, &ssu_enabled));
+		CHECK(setting_get_bool(SETTING_DYN_UPDATE, zone_settings,
+				       &ssu_enabled));
 		if (ssu_enabled) {
 			/* Get the update policy and update the zone with it. */
-			CHECK(setting_get_str("update_policy", zone_settings,
+			CHECK(setting_get_str(SETTING_UPDATE_POLICY, zone_settings,
 					      &ssu_policy));
 			dns_zone_log(raw, ISC_LOG_DEBUG(2),
 				     "setting update-policy to '%s'",
@@ -1884,34 +2578,56 @@ zone_master_reconfigure(ldap_entry_t *entry, settings_set_t *zone_settings,
 		}
 	}
 
-	/* Fetch allow-query and allow-transfer ACLs */
-	result = ldap_entry_getvalues(entry, "idnsAllowQuery", &values);
+	/* Fetch allow-query and allow-transfer ACLs. ACLs are parsed
+	 * only if they differ from the last version of the zone object. */
+	result = setting_update_from_ldap_entry("allow_query", zone_settings,
+						"idnsAllowQuery", entry);
 	if (result == ISC_R_SUCCESS) {
-		dns_zone_log(inview, ISC_LOG_DEBUG(2),
-			     "setting allow-query to '%s'",
-			     HEAD(values)->value);
-		CHECK(configure_zone_acl(mctx, inview, &dns_zone_setqueryacl,
-					 HEAD(values)->value, acl_type_query));
-	} else {
-		dns_zone_log(inview, ISC_LOG_DEBUG(2), "allow-query is not set");
-		dns_zone_clearqueryacl(raw);
-	}
+		acl_setting = "allow_query";
+		result = ldap_entry_getvalues(entry, "idnsAllowQuery", &values);
+		if (result == ISC_R_SUCCESS) {
+			dns_zone_log(inview, ISC_LOG_DEBUG(2),
+				     "setting allow-query to '%s'",
+				     HEAD(values)->value);
+			CHECK(configure_zone_acl(mctx, inview,
+						 &dns_zone_setqueryacl,
+						 HEAD(values)->value,
+						 acl_type_query));
+		} else {
+			dns_zone_log(inview, ISC_LOG_DEBUG(2),
+				     "allow-query is not set");
+			dns_zone_clearqueryacl(raw);
+		}
+	} else if (result != ISC_R_IGNORE)
+		goto cleanup;
+	acl_setting = NULL;
 
-	result = ldap_entry_getvalues(entry, "idnsAllowTransfer", &values);
+	result = setting_update_from_ldap_entry("allow_transfer",
+						zone_settings,
+						"idnsAllowTransfer", entry);
 	if (result == ISC_R_SUCCESS) {
-		dns_zone_log(inview, ISC_LOG_DEBUG(2),
-			     "setting allow-transfer to '%s'",
-			     HEAD(values)->value);
-		CHECK(configure_zone_acl(mctx, inview, &dns_zone_setxfracl,
-					 HEAD(values)->value, acl_type_transfer));
-	} else {
-		dns_zone_log(inview, ISC_LOG_DEBUG(2),
-			     "allow-transfer is not set");
-		dns_zone_clearxfracl(raw);
-		result = ISC_R_SUCCESS;
-	}
-
-	if (secure != NULL) {
+		acl_setting = "allow_transfer";
+		result = ldap_entry_getvalues(entry, "idnsAllowTransfer",
+					      &values);
+		if (result == ISC_R_SUCCESS) {
+			dns_zone_log(inview, ISC_LOG_DEBUG(2),
+				     "setting allow-transfer to '%s'",
+				     HEAD(values)->value);
+			CHECK(configure_zone_acl(mctx, inview,
+						 &dns_zone_setxfracl,
+						 HEAD(values)->value,
+						 acl_type_transfer));
+		} else {
+			dns_zone_log(inview, ISC_LOG_DEBUG(2),
+				     "allow-transfer is not set");
+			dns_zone_clearxfracl(raw);
+		}
+	} else if (result != ISC_R_IGNORE)
+		goto cleanup;
+	acl_setting = NULL;
+	result = ISC_R_SUCCESS;
+
+	if (secure != NULL) {
 		/* notifications should be sent from secure zone only */
 		dns_zone_setnotifytype(raw, dns_notifytype_no);
 
@@ -1955,6 +2671,9 @@ zone_master_reconfigure(ldap_entry_t *entry, settings_set_t *zone_settings,
 	}
 
 cleanup:
+	/* ACL was stored in settings but it was not applied. */
+	if (acl_setting != NULL)
+		zone_setting_retry(zone_settings, acl_setting);
 	if (inview != NULL)
 		dns_zone_detach(&inview);
 	return result;
@@ -2125,6 +2844,7 @@ ldap_parse_master_zoneentry(ldap_entry_t * const entry, dns_db_t * const olddb,
 	bool want_secure = false;
 	bool configured = false;
 	bool activity_changed;
+	bool fwd_changed = false;
 	bool isactive = false;
 	settings_set_t *zone_settings = NULL;
 	bool ldap_writeback;
@@ -2136,6 +2856,8 @@ ldap_parse_master_zoneentry(ldap_entry_t * const entry, dns_db_t * const olddb,
 	dns_diff_t diff;
 	dns_dbversion_t *version = NULL;
 	sync_state_t sync_state;
+	zone_handle_t *zone = NULL;
+	bool pending;
 
 	REQUIRE(entry != NULL);
 	REQUIRE(inst != NULL);
@@ -2175,12 +2897,18 @@ ldap_parse_master_zoneentry(ldap_entry_t * const entry, dns_db_t * const olddb,
 		INSIST(olddb == NULL);
 	}
 
+	CHECK(zr_get_zone_handle(inst->zone_register, &entry->fqdn, &zone));
 	CHECK(zr_get_zone_settings(inst->zone_register, &entry->fqdn,
 				   &zone_settings));
 	CHECK(zone_master_reconfigure(entry, zone_settings, raw, secure, task));
+	/* Forward policy is un-set only if forwarding configuration
+	 * was not applied, see below. */
+	fwd_changed = (setting_find("forward_policy", zone_settings, false,
+				    true, NULL) != ISC_R_SUCCESS);
 	result = fwd_parse_ldap(entry, zone_settings);
 	if (result != ISC_R_SUCCESS && result != ISC_R_IGNORE)
 		goto cleanup;
+	fwd_changed = (fwd_changed == true || result == ISC_R_SUCCESS);
 	/* synchronize zone origin with LDAP */
 	CHECK(zr_get_zone_dbs(inst->zone_register, &entry->fqdn, &ldapdb, &rbtdb));
 	CHECK(dns_db_newversion(ldapdb, &version));
@@ -2198,7 +2926,7 @@ ldap_parse_master_zoneentry(ldap_entry_t * const entry, dns_db_t * const olddb,
 	if (ldap_writeback == true) {
 		dns_zone_log(raw, ISC_LOG_DEBUG(5), "writing new zone serial "
 			     "%u to LDAP", new_serial);
-		result = ldap_replace_serial(inst, &entry->fqdn, new_serial);
+		result = ldap_serial_writeback(inst, &entry->fqdn, new_serial);
 		if (result != ISC_R_SUCCESS)
 			dns_zone_log(raw, ISC_LOG_ERROR,
 				     "serial (%u) write back to LDAP failed",
@@ -2208,6 +2936,7 @@ ldap_parse_master_zoneentry(ldap_entry_t * const entry, dns_db_t * const olddb,
 	if (!EMPTY(diff.tuples)) {
 		if (sync_state == sync_finished && new_zone == false) {
 			/* write the transaction to journal */
+			cleanup_stale_files(zone);
 			CHECK(zone_journal_adddiff(inst->mctx, raw, &diff));
 		}
 
@@ -2232,18 +2961,32 @@ ldap_parse_master_zoneentry(ldap_entry_t * const entry, dns_db_t * const olddb,
 		activity_changed = false;
 	} else
 		goto cleanup;
-	CHECK(setting_get_bool("active", zone_settings, &isactive));
+	CHECK(setting_get_bool(SETTING_ACTIVE, zone_settings, &isactive));
 
-	/* Do zone load only if the initial LDAP synchronization is done. */
-	if (sync_state != sync_finished)
+	/* Do zone load only if the initial LDAP synchronization is done.
+	 * Forwarding is configured by activate_zones() otherwise. */
+	if (sync_state != sync_finished) {
+		fwd_changed = false;
 		goto cleanup;
+	}
 
 	toview = (want_secure == true) ? secure : raw;
+	pending = publish_zone_ispending(inst, zone);
 	if (isactive == true) {
+		/* Queued zone is loaded and configured when published. */
 		if (new_zone == true || activity_changed == true)
-			CHECK(publish_zone(inst, toview));
-		CHECK(load_zone(toview, false));
-		CHECK(fwd_configure_zone(zone_settings, inst, &entry->fqdn));
+			CHECK(publish_zone_defer(inst, &entry->fqdn));
+		else if (pending == false) {
+			CHECK(load_zone(toview, false));
+			if (fwd_changed == true)
+				CHECK(fwd_configure_zone(zone_settings, inst,
+							 &entry->fqdn));
+		}
+	} else if (activity_changed == true && pending == true) {
+		/* Zone was never published, publish_pending_zones()
+		 * skips inactive zones. */
+		dns_zone_log(toview, ISC_LOG_INFO, "zone deactivated "
+			     "before publication");
 	} else if (activity_changed == true) { /* Zone was deactivated */
 		CHECK(unpublish_zone(inst, &entry->fqdn,
 				     ldap_entry_logname(entry)));
@@ -2253,8 +2996,14 @@ ldap_parse_master_zoneentry(ldap_entry_t * const entry, dns_db_t * const olddb,
 		dns_zone_log(toview, ISC_LOG_INFO, "zone deactivated "
 			     "and removed from view");
 	}
+	/* Forwarding of inactive and queued zones is configured
+	 * when the zone is published. */
+	fwd_changed = false;
 
 cleanup:
+	/* Forwarding configuration was stored in settings but not applied. */
+	if (fwd_changed == true)
+		zone_setting_retry(zone_settings, "forward_policy");
 	dns_diff_clear(&diff);
 	if (rbtdb != NULL && version != NULL)
 		dns_db_closeversion(ldapdb, &version, false); /* rollback */
@@ -2262,6 +3011,7 @@ cleanup:
 		dns_db_detach(&rbtdb);
 	if (ldapdb != NULL)
 		dns_db_detach(&ldapdb);
+	zone_handle_detach(&zone);
 	if (new_zone == true && configured == false) {
 		/* Failure in ACL parsing or so. */
 		log_error_r("%s: publishing failed, rolling back due to",
@@ -2582,7 +3332,8 @@ ldap_parse_rrentry(isc_mem_t *mctx, ldap_entry_t *entry, dns_name_t *origin,
 	ttl = ldap_entry_getttl(entry, settings);
 	rdclass = ldap_entry_getrdclass(entry);
 	if ((entry->class & LDAP_ENTRYCLASS_MASTER) != 0) {
-		CHECK(setting_get_str("fake_mname", settings, &fake_mname));
+		CHECK(setting_get_str(SETTING_FAKE_MNAME, settings,
+				      &fake_mname));
 		CHECK(add_soa_record(mctx, origin, entry, ttl, rdatalist,
 				     fake_mname));
 	}
@@ -2747,7 +3498,7 @@ ldap_sasl_interact(LDAP *ld, unsigned flags, void *defaults, void *sin)
 		switch (in->id) {
 		case SASL_CB_USER:
 			log_debug(4, "got request for SASL_CB_USER");
-			CHECK(setting_get_str("sasl_user",
+			CHECK(setting_get_str(SETTING_SASL_USER,
 					      ldap_inst->server_ldap_settings,
 					      (const char **)&in->result));
 			in->len = strlen(in->result);
@@ -2755,7 +3506,7 @@ ldap_sasl_interact(LDAP *ld, unsigned flags, void *defaults, void *sin)
 			break;
 		case SASL_CB_GETREALM:
 			log_debug(4, "got request for SASL_CB_GETREALM");
-			CHECK(setting_get_str("sasl_realm",
+			CHECK(setting_get_str(SETTING_SASL_REALM,
 					      ldap_inst->server_ldap_settings,
 					      (const char **)&in->result));
 			in->len = strlen(in->result);
@@ -2763,7 +3514,7 @@ ldap_sasl_interact(LDAP *ld, unsigned flags, void *defaults, void *sin)
 			break;
 		case SASL_CB_AUTHNAME:
 			log_debug(4, "got request for SASL_CB_AUTHNAME");
-			CHECK(setting_get_str("sasl_auth_name",
+			CHECK(setting_get_str(SETTING_SASL_AUTH_NAME,
 					      ldap_inst->server_ldap_settings,
 					      (const char **)&in->result));
 			in->len = strlen(in->result);
@@ -2771,7 +3522,7 @@ ldap_sasl_interact(LDAP *ld, unsigned flags, void *defaults, void *sin)
 			break;
 		case SASL_CB_PASS:
 			log_debug(4, "got request for SASL_CB_PASS");
-			CHECK(setting_get_str("sasl_password",
+			CHECK(setting_get_str(SETTING_SASL_PASSWORD,
 					      ldap_inst->server_ldap_settings,
 					      (const char **)&in->result));
 			in->len = strlen(in->result);
@@ -2790,9 +3541,44 @@ cleanup:
 	return LDAP_OTHER;
 }
 
+/**
+ * Get list of servers the connection should be bound to.
+ */
+static server_list_t * ATTR_NONNULLS ATTR_CHECKRESULT
+ldap_conn_servers(ldap_instance_t *inst, ldap_connection_t *ldap_conn)
+{
+	if (ldap_conn->watcher == true && inst->watcher_servers != NULL)
+		return inst->watcher_servers;
+	return inst->servers;
+}
+
+/**
+ * Compute delay before reconnect attempt number tries + 1.
+ *
+ * The delay grows exponentially from RECONNECT_BACKOFF_MIN seconds up to
+ * the ceiling. Only the upper half of the delay is fixed, the lower half
+ * is random so connections, and DNS servers sharing the same LDAP server,
+ * which lost connection at the same moment do not reconnect in lock-step.
+ */
+static unsigned int ATTR_CHECKRESULT
+reconnect_backoff(unsigned int tries, unsigned int ceiling)
+{
+	unsigned int delay;
+
+	delay = RECONNECT_BACKOFF_MIN << ISC_MIN(tries, 16);
+	delay = ISC_MIN(delay, ceiling);
+	if (delay < 2)
+		return delay;
+	return delay / 2 + random_uniform(delay / 2 + 1);
+}
+
 /*
  * Initialize the LDAP handle and bind to the server. Needed authentication
  * credentials and settings are available from the ldap_inst.
+ *
+ * Servers from 'uri' setting are tried in order given by server_list_order().
+ * Only the first one is subject to reconnect_interval, servers which
+ * follow it are tried immediately if the first one is not reachable.
  */
 static isc_result_t ATTR_NONNULLS ATTR_CHECKRESULT
 bdl_ldap_connect(ldap_instance_t *ldap_inst, ldap_connection_t *ldap_conn,
@@ -2806,44 +3592,115 @@ bdl_ldap_connect(ldap_instance_t *ldap_inst, ldap_connection_t *ldap_conn,
 	const char *uri = NULL;
 	const char *ldap_hostname = NULL;
 	uint32_t timeout_sec;
+	int order[SERVER_LIST_MAX];
+	unsigned int count;
+	unsigned int i;
+	isc_time_t start;
+	isc_time_t now;
+	uint32_t keepalive_idle;
+	uint32_t keepalive_probes;
+	uint32_t keepalive_interval;
+	server_list_t *servers;
 
 	REQUIRE(ldap_inst != NULL);
 	REQUIRE(ldap_conn != NULL);
 
-	CHECK(setting_get_str("uri", ldap_inst->local_settings, &uri));
-	ret = ldap_initialize(&ld, uri);
-	if (ret != LDAP_SUCCESS) {
-		log_error("LDAP initialization failed: %s",
-			  ldap_err2string(ret));
-		CLEANUP_WITH(ISC_R_FAILURE);
+	servers = ldap_conn_servers(ldap_inst, ldap_conn);
+	if (ldap_conn->server != SERVER_NONE) {
+		server_list_release(servers, ldap_conn->server);
+		ldap_conn->server = SERVER_NONE;
 	}
 
-	version = LDAP_VERSION3;
-	ret = ldap_set_option(ld, LDAP_OPT_PROTOCOL_VERSION, &version);
-	LDAP_OPT_CHECK(ret, "failed to set LDAP version");
-
-	CHECK(setting_get_uint("timeout", ldap_inst->server_ldap_settings,
+	CHECK(setting_get_uint(SETTING_TIMEOUT, ldap_inst->server_ldap_settings,
 			       &timeout_sec));
 	timeout.tv_sec = timeout_sec;
 	timeout.tv_usec = 0;
+	CHECK(setting_get_str(SETTING_LDAP_HOSTNAME, ldap_inst->local_settings,
+			      &ldap_hostname));
+	CHECK(setting_get_uint(SETTING_KEEPALIVE_IDLE, ldap_inst->local_settings,
+			       &keepalive_idle));
+	CHECK(setting_get_uint(SETTING_KEEPALIVE_PROBES, ldap_inst->local_settings,
+			       &keepalive_probes));
+	CHECK(setting_get_uint(SETTING_KEEPALIVE_INTERVAL, ldap_inst->local_settings,
+			       &keepalive_interval));
+
+	count = server_list_order(servers, ldap_conn->watcher, order);
+	for (i = 0; i < count; i++) {
+		result = ISC_R_FAILURE;
+		uri = server_list_uri(servers, order[i]);
+		ret = ldap_initialize(&ld, uri);
+		if (ret != LDAP_SUCCESS) {
+			log_error("LDAP initialization failed: %s",
+				  ldap_err2string(ret));
+			CLEANUP_WITH(ISC_R_FAILURE);
+		}
 
-	ret = ldap_set_option(ld, LDAP_OPT_TIMEOUT, &timeout);
-	LDAP_OPT_CHECK(ret, "failed to set timeout");
+		version = LDAP_VERSION3;
+		ret = ldap_set_option(ld, LDAP_OPT_PROTOCOL_VERSION, &version);
+		LDAP_OPT_CHECK(ret, "failed to set LDAP version");
 
-	CHECK(setting_get_str("ldap_hostname", ldap_inst->local_settings,
-			      &ldap_hostname));
-	if (strlen(ldap_hostname) > 0) {
-		ret = ldap_set_option(ld, LDAP_OPT_HOST_NAME, ldap_hostname);
-		LDAP_OPT_CHECK(ret, "failed to set LDAP_OPT_HOST_NAME");
-	}
+		ret = ldap_set_option(ld, LDAP_OPT_TIMEOUT, &timeout);
+		LDAP_OPT_CHECK(ret, "failed to set timeout");
 
-	if (ldap_conn->handle != NULL)
-		ldap_unbind_ext_s(ldap_conn->handle, NULL, NULL);
-	ldap_conn->handle = ld;
-	ld = NULL; /* prevent double-unbind from bdl_ldap_reconnect() and cleanup: */
+		if (strlen(ldap_hostname) > 0) {
+			ret = ldap_set_option(ld, LDAP_OPT_HOST_NAME,
+					      ldap_hostname);
+			LDAP_OPT_CHECK(ret, "failed to set LDAP_OPT_HOST_NAME");
+		}
 
-	CHECK(bdl_ldap_reconnect(ldap_inst, ldap_conn, force));
-	return result;
+		/* Keep idle connections alive through firewalls and NAT,
+		 * value 0 leaves the system default. */
+#ifdef LDAP_OPT_X_KEEPALIVE_IDLE
+		if (keepalive_idle > 0) {
+			int value = keepalive_idle;
+			ret = ldap_set_option(ld, LDAP_OPT_X_KEEPALIVE_IDLE,
+					      &value);
+			LDAP_OPT_CHECK(ret, "failed to set "
+				       "LDAP_OPT_X_KEEPALIVE_IDLE");
+		}
+		if (keepalive_probes > 0) {
+			int value = keepalive_probes;
+			ret = ldap_set_option(ld, LDAP_OPT_X_KEEPALIVE_PROBES,
+					      &value);
+			LDAP_OPT_CHECK(ret, "failed to set "
+				       "LDAP_OPT_X_KEEPALIVE_PROBES");
+		}
+		if (keepalive_interval > 0) {
+			int value = keepalive_interval;
+			ret = ldap_set_option(ld, LDAP_OPT_X_KEEPALIVE_INTERVAL,
+					      &value);
+			LDAP_OPT_CHECK(ret, "failed to set "
+				       "LDAP_OPT_X_KEEPALIVE_INTERVAL");
+		}
+#else
+		UNUSED(keepalive_idle);
+		UNUSED(keepalive_probes);
+		UNUSED(keepalive_interval);
+#endif
+
+		if (ldap_conn->handle != NULL)
+			ldap_unbind_ext_s(ldap_conn->handle, NULL, NULL);
+		ldap_conn->handle = ld;
+		ld = NULL; /* prevent double-unbind from bdl_ldap_reconnect() and cleanup: */
+
+		log_debug(2, "trying to establish LDAP connection to %s", uri);
+		if (isc_time_now(&start) != ISC_R_SUCCESS)
+			isc_time_settoepoch(&start);
+		result = bdl_ldap_reconnect(ldap_inst, ldap_conn,
+					    force || i > 0);
+		if (result == ISC_R_SUCCESS) {
+			if (isc_time_now(&now) != ISC_R_SUCCESS)
+				now = start;
+			server_list_success(servers, order[i],
+					    isc_time_microdiff(&now, &start));
+			ldap_conn->server = order[i];
+			return result;
+		} else if (result != ISC_R_NOTCONNECTED &&
+			   result != ISC_R_TIMEDOUT) {
+			goto cleanup;
+		}
+		server_list_failure(servers, order[i]);
+	}
 
 cleanup:
 	if (ld != NULL)
@@ -2866,7 +3723,7 @@ bdl_ldap_reconnect(ldap_instance_t *ldap_inst, ldap_connection_t *ldap_conn,
 	int ret = 0;
 	const char *bind_dn = NULL;
 	const char *password = NULL;
-	const char *uri = NULL;
+	const char *watcher_bind_dn = NULL;
 	const char *sasl_mech = NULL;
 	const char *krb5_principal = NULL;
 	const char *krb5_keytab = NULL;
@@ -2889,53 +3746,63 @@ bdl_ldap_reconnect(ldap_instance_t *ldap_inst, ldap_connection_t *ldap_conn,
 	/* Set the next possible reconnect time. */
 	{
 		isc_interval_t delay;
-		unsigned int i;
-		unsigned int seconds;
-		const unsigned int intervals[] = { 2, 5, 20, UINT_MAX };
-		const size_t ntimes = sizeof(intervals) / sizeof(intervals[0]);
 
-		i = ISC_MIN(ntimes - 1, ldap_conn->tries);
-		CHECK(setting_get_uint("reconnect_interval",
+		CHECK(setting_get_uint(SETTING_RECONNECT_INTERVAL,
 				       ldap_inst->server_ldap_settings,
 				       &reconnect_interval));
-		seconds = ISC_MIN(intervals[i], reconnect_interval);
-		isc_interval_set(&delay, seconds, 0);
+		isc_interval_set(&delay,
+				 reconnect_backoff(ldap_conn->tries,
+						   reconnect_interval), 0);
 		isc_time_nowplusinterval(&ldap_conn->next_reconnect, &delay);
 	}
 
 	ldap_conn->tries++;
 force_reconnect:
-	CHECK(setting_get_str("uri", ldap_inst->local_settings, &uri));
-	log_debug(2, "trying to establish LDAP connection to %s", uri);
-
-	CHECK(setting_get_uint("auth_method_enum", ldap_inst->local_settings,
+	CHECK(setting_get_uint(SETTING_AUTH_METHOD_ENUM, ldap_inst->local_settings,
 			       &auth_method_enum));
 	switch (auth_method_enum) {
 	case AUTH_NONE:
 		ret = ldap_simple_bind_s(ldap_conn->handle, NULL, NULL);
 		break;
 	case AUTH_SIMPLE:
-		CHECK(setting_get_str("bind_dn", ldap_inst->server_ldap_settings,
+		CHECK(setting_get_str(SETTING_BIND_DN, ldap_inst->server_ldap_settings,
 				      &bind_dn));
-		CHECK(setting_get_str("password", ldap_inst->server_ldap_settings,
+		CHECK(setting_get_str(SETTING_PASSWORD, ldap_inst->server_ldap_settings,
 				      &password));
+		if (ldap_conn->watcher == true) {
+			CHECK(setting_get_str(SETTING_WATCHER_BIND_DN,
+					      ldap_inst->local_settings,
+					      &watcher_bind_dn));
+			if (strlen(watcher_bind_dn) > 0) {
+				bind_dn = watcher_bind_dn;
+				CHECK(setting_get_str(SETTING_WATCHER_PASSWORD,
+						      ldap_inst->local_settings,
+						      &password));
+			}
+		}
 		ret = ldap_simple_bind_s(ldap_conn->handle, bind_dn, password);
 		break;
 	case AUTH_SASL:
-		CHECK(setting_get_str("sasl_mech", ldap_inst->local_settings,
+		CHECK(setting_get_str(SETTING_SASL_MECH, ldap_inst->local_settings,
 				      &sasl_mech));
 		if (strcmp(sasl_mech, "GSSAPI") == 0) {
-			CHECK(setting_get_str("krb5_principal",
+			CHECK(setting_get_str(SETTING_KRB5_PRINCIPAL,
 					      ldap_inst->local_settings,
 					      &krb5_principal));
-			CHECK(setting_get_str("krb5_keytab",
+			CHECK(setting_get_str(SETTING_KRB5_KEYTAB,
 					      ldap_inst->local_settings,
 					      &krb5_keytab));
 			LOCK(&ldap_inst->kinit_lock);
-			result = get_krb5_tgt(ldap_inst->mctx,
-					      krb5_principal,
-					      krb5_keytab);
+			if (ldap_inst->tgt_cache == NULL)
+				result = krb5_tgt_cache_create(ldap_inst->mctx,
+						krb5_principal, krb5_keytab,
+						&ldap_inst->tgt_cache);
+			else
+				result = ISC_R_SUCCESS;
 			UNLOCK(&ldap_inst->kinit_lock);
+			if (result == ISC_R_SUCCESS)
+				result = krb5_tgt_cache_get(
+						ldap_inst->tgt_cache);
 			if (result != ISC_R_SUCCESS)
 				return ISC_R_NOTCONNECTED;
 		}
@@ -3108,7 +3975,8 @@ retry:
 			operation_str);
 
 	/* If there is no object yet, create it with an ldap add operation. */
-	if ((mods[0]->mod_op & ~LDAP_MOD_BVALUES) == LDAP_MOD_ADD &&
+	if (((mods[0]->mod_op & ~LDAP_MOD_BVALUES) == LDAP_MOD_ADD ||
+	     (mods[0]->mod_op & ~LDAP_MOD_BVALUES) == LDAP_MOD_REPLACE) &&
 	     err_code == LDAP_NO_SUCH_OBJECT) {
 		int i;
 		LDAPMod **new_mods;
@@ -3351,11 +4219,17 @@ cleanup:
  * refresh, retry, expire and minimum attributes for each SOA record.
  */
 static isc_result_t ATTR_NONNULLS ATTR_CHECKRESULT
-modify_soa_record(ldap_instance_t *ldap_inst, const char *zone_dn,
-		  dns_rdata_t *rdata)
+modify_soa_record(ldap_instance_t *ldap_inst, dns_name_t *zone,
+		  const char *zone_dn, dns_rdata_t *rdata)
 {
 	isc_result_t result = ISC_R_SUCCESS;
 	dns_rdata_soa_t soa;
+	dns_rdata_soa_t old_soa;
+	bool have_old = false;
+	dns_db_t *rbtdb = NULL;
+	dns_dbversion_t *version = NULL;
+	dns_difftuple_t *old_tuple = NULL;
+	unsigned int n = 0;
 	int s_len;
 	LDAPMod change[5];
 	LDAPMod *changep[6] = {
@@ -3367,31 +4241,63 @@ modify_soa_record(ldap_instance_t *ldap_inst, const char *zone_dn,
 
 /* all values in SOA record are uint32_t, i.e. max. 2^32-1 */
 #define MAX_SOANUM_LENGTH (10 + 1)
-#define SET_LDAP_MOD(index, name) \
-	change[index].mod_op = LDAP_MOD_REPLACE; \
-	change[index].mod_type = "idnsSOA" #name; \
-	change[index].mod_values = alloca(2 * sizeof(char *)); \
-	change[index].mod_values[0] = alloca(MAX_SOANUM_LENGTH); \
-	change[index].mod_values[1] = NULL; \
-	s_len = snprintf(change[index].mod_values[0], MAX_SOANUM_LENGTH, \
-			 "%u", soa.name); \
-	if (s_len < 0 || s_len >= MAX_SOANUM_LENGTH) { \
-		CLEANUP_WITH(ISC_R_NOSPACE); \
+#define SET_LDAP_MOD(name) \
+	if (have_old == false || soa.name != old_soa.name) { \
+		change[n].mod_op = LDAP_MOD_REPLACE; \
+		change[n].mod_type = "idnsSOA" #name; \
+		change[n].mod_values = alloca(2 * sizeof(char *)); \
+		change[n].mod_values[0] = alloca(MAX_SOANUM_LENGTH); \
+		change[n].mod_values[1] = NULL; \
+		s_len = snprintf(change[n].mod_values[0], MAX_SOANUM_LENGTH, \
+				 "%u", soa.name); \
+		if (s_len < 0 || s_len >= MAX_SOANUM_LENGTH) { \
+			CLEANUP_WITH(ISC_R_NOSPACE); \
+		} \
+		n++; \
 	}
 
-	dns_rdata_tostruct(rdata, (void *)&soa, ldap_inst->mctx);
-
-	SET_LDAP_MOD(0, serial);
-	SET_LDAP_MOD(1, refresh);
-	SET_LDAP_MOD(2, retry);
-	SET_LDAP_MOD(3, expire);
-	SET_LDAP_MOD(4, minimum);
-
-	dns_rdata_freestruct((void *)&soa);
+	/* LDAP contains the SOA record from current RBTDB version,
+	 * except the serial which might wait for write back. */
+	if (zr_get_zone_dbs(ldap_inst->zone_register, zone, NULL, &rbtdb)
+	    == ISC_R_SUCCESS) {
+		dns_db_currentversion(rbtdb, &version);
+		if (dns_db_createsoatuple(rbtdb, version, ldap_inst->mctx,
+					  DNS_DIFFOP_EXISTS, &old_tuple)
+		    == ISC_R_SUCCESS) {
+			dns_rdata_tostruct(&old_tuple->rdata, (void *)&old_soa,
+					   NULL);
+			have_old = true;
+		}
+	}
+	dns_rdata_tostruct(rdata, (void *)&soa, NULL);
 
+	if (have_old == false || soa.serial != old_soa.serial) {
+		if (ldap_inst->serial_timer != NULL)
+			CHECK(ldap_serial_writeback(ldap_inst, zone,
+						    soa.serial));
+		else
+			SET_LDAP_MOD(serial);
+	}
+	SET_LDAP_MOD(refresh);
+	SET_LDAP_MOD(retry);
+	SET_LDAP_MOD(expire);
+	SET_LDAP_MOD(minimum);
+
+	if (n == 0) {
+		log_debug(5, "SOA record of zone '%s' is unchanged, "
+			  "skipping LDAP write", zone_dn);
+		goto cleanup;
+	}
+	changep[n] = NULL;
 	result = ldap_modify_do(ldap_inst, zone_dn, changep, false);
 
 cleanup:
+	if (old_tuple != NULL)
+		dns_difftuple_free(&old_tuple);
+	if (version != NULL)
+		dns_db_closeversion(rbtdb, &version, false);
+	if (rbtdb != NULL)
+		dns_db_detach(&rbtdb);
 	return result;
 
 #undef MAX_SOANUM_LENGTH
@@ -3408,32 +4314,23 @@ modify_ldap_common(dns_name_t *owner, dns_name_t *zone, ldap_instance_t *ldap_in
 	LDAPMod *change[3] = { NULL };
 	bool zone_sync_ptr;
 	char **vals = NULL;
-	dns_name_t zone_name;
-	char *zone_dn = NULL;
+	size_t zone_dn_offset;
+	const char *zone_dn = NULL;
 	settings_set_t *zone_settings = NULL;
 	int af; /* address family */
 	bool unknown_type = false;
 
 	/*
 	 * Find parent zone entry and check if Dynamic Update is allowed.
-	 * @todo Try the cache first and improve split: SOA records are problematic.
+	 * Zone DN is a suffix of owner DN, for zone apex they are equal.
 	 */
-	dns_name_init(&zone_name, NULL);
 	CHECK(str_new(mctx, &owner_dn));
 
-	CHECK(dnsname_to_dn(ldap_inst->zone_register, owner, zone, owner_dn));
-	zone_dn = strstr(str_buf(owner_dn),", ");
-
-	if (zone_dn == NULL) { /* SOA record; owner = zone => owner_dn = zone_dn */
-		zone_dn = (char *)str_buf(owner_dn);
-	} else {
-		zone_dn += 1; /* skip whitespace */
-	}
-
-	CHECK(dn_to_dnsname(mctx, zone_dn, &zone_name, NULL, NULL));
-	INSIST(dns_name_equal(zone, &zone_name) == true);
+	CHECK(dnsname_to_dn(ldap_inst->zone_register, owner, zone, owner_dn,
+			    &zone_dn_offset));
+	zone_dn = str_buf(owner_dn) + zone_dn_offset;
 
-	result = zr_get_zone_settings(ldap_inst->zone_register, &zone_name,
+	result = zr_get_zone_settings(ldap_inst->zone_register, zone,
 				      &zone_settings);
 	if (result != ISC_R_SUCCESS) {
 		if (result == ISC_R_NOTFOUND)
@@ -3446,12 +4343,12 @@ modify_ldap_common(dns_name_t *owner, dns_name_t *zone, ldap_instance_t *ldap_in
 		CLEANUP_WITH(ISC_R_SUCCESS);
 
 	if (rdlist->type == dns_rdatatype_soa) {
-		result = modify_soa_record(ldap_inst, str_buf(owner_dn),
+		result = modify_soa_record(ldap_inst, zone, str_buf(owner_dn),
 					   HEAD(rdlist->rdata));
 		goto cleanup;
 	}
 
-	if (mod_op == LDAP_MOD_ADD) {
+	if (mod_op != LDAP_MOD_DELETE) {
 		/* for now always replace the ttl on add */
 		CHECK(ldap_rdttl_to_ldapmod(mctx, rdlist, &change[1]));
 	}
@@ -3468,14 +4365,17 @@ modify_ldap_common(dns_name_t *owner, dns_name_t *zone, ldap_instance_t *ldap_in
 		unknown_type = !unknown_type; /* try again with unknown type */
 	} while (result == DNS_R_UNKNOWN && unknown_type == true);
 
-	/* Keep the PTR of corresponding A/AAAA record synchronized. */
-	if (rdlist->type == dns_rdatatype_a || rdlist->type == dns_rdatatype_aaaa) {
+	/* Keep the PTR of corresponding A/AAAA record synchronized.
+	 * Replaced values are not known so replace cannot be synchronized. */
+	if (mod_op != LDAP_MOD_REPLACE &&
+	    (rdlist->type == dns_rdatatype_a || rdlist->type == dns_rdatatype_aaaa)) {
 		/*
 		 * Look for zone "idnsAllowSyncPTR" attribute. If attribute do not exist,
 		 * use global plugin configuration: option "sync_ptr"
 		 */
 
-		CHECK(setting_get_bool("sync_ptr", zone_settings, &zone_sync_ptr));
+		CHECK(setting_get_bool(SETTING_SYNC_PTR, zone_settings,
+				       &zone_sync_ptr));
 		if (!zone_sync_ptr) {
 			log_debug(3, "sync PTR is disabled for zone '%s'", zone_dn);
 			CLEANUP_WITH(ISC_R_SUCCESS);
@@ -3484,8 +4384,8 @@ modify_ldap_common(dns_name_t *owner, dns_name_t *zone, ldap_instance_t *ldap_in
 
 		af = (rdlist->type == dns_rdatatype_a) ? AF_INET : AF_INET6;
 		/* Following call will not work if A/AAAA records are unknown. */
-		result = sync_ptr_init(mctx, ldap_inst->view->zonetable,
-				       ldap_inst->zone_register, owner, af,
+		result = sync_ptr_init(ldap_inst->syncptr,
+				       ldap_inst->view->zonetable, owner, af,
 				       change[0]->mod_values[0], rdlist->ttl,
 				       mod_op);
 		/* Silently ignore cases where the reverse zone does not exist,
@@ -3502,7 +4402,6 @@ cleanup:
 	ldap_mod_free(mctx, &change[0]);
 	ldap_mod_free(mctx, &change[1]);
 	free_char_array(mctx, &vals);
-	dns_name_free(&zone_name, mctx);
 
 	return result;
 }
@@ -3513,6 +4412,17 @@ write_to_ldap(dns_name_t *owner, dns_name_t *zone, ldap_instance_t *ldap_inst, d
 	return modify_ldap_common(owner, zone, ldap_inst, rdlist, LDAP_MOD_ADD, false);
 }
 
+/**
+ * Replace all values of given RR type with values from rdlist.
+ */
+isc_result_t
+replace_in_ldap(dns_name_t *owner, dns_name_t *zone, ldap_instance_t *ldap_inst,
+		dns_rdatalist_t *rdlist)
+{
+	return modify_ldap_common(owner, zone, ldap_inst, rdlist, LDAP_MOD_REPLACE,
+				  false);
+}
+
 isc_result_t
 remove_values_from_ldap(dns_name_t *owner, dns_name_t *zone, ldap_instance_t *ldap_inst,
 		 dns_rdatalist_t *rdlist, bool delete_node)
@@ -3535,7 +4445,7 @@ remove_rdtype_from_ldap(dns_name_t *owner, dns_name_t *zone,
 	bool unknown_type = false;
 
 	CHECK(str_new(ldap_inst->mctx, &dn));
-	CHECK(dnsname_to_dn(ldap_inst->zone_register, owner, zone, dn));
+	CHECK(dnsname_to_dn(ldap_inst->zone_register, owner, zone, dn, NULL));
 
 	do {
 		CHECK(ldap_mod_create(ldap_inst->mctx, &change[0]));
@@ -3568,7 +4478,7 @@ remove_entry_from_ldap(dns_name_t *owner, dns_name_t *zone, ldap_instance_t *lda
 	isc_result_t result;
 
 	CHECK(str_new(ldap_inst->mctx, &dn));
-	CHECK(dnsname_to_dn(ldap_inst->zone_register, owner, zone, dn));
+	CHECK(dnsname_to_dn(ldap_inst->zone_register, owner, zone, dn, NULL));
 	log_debug(2, "deleting whole node: '%s'", str_buf(dn));
 
 	CHECK(ldap_pool_getconnection(ldap_inst->pool, &ldap_conn));
@@ -3600,30 +4510,39 @@ cleanup:
 
 
 static isc_result_t ATTR_NONNULLS ATTR_CHECKRESULT
-ldap_pool_create(isc_mem_t *mctx, unsigned int connections, ldap_pool_t **poolp)
+ldap_pool_create(isc_mem_t *mctx, unsigned int min_connections,
+		 unsigned int max_connections, uint32_t idle_timeout,
+		 uint32_t check_interval, ldap_pool_t **poolp)
 {
 	ldap_pool_t *pool;
-	isc_result_t result;
 
 	REQUIRE(poolp != NULL && *poolp == NULL);
+	REQUIRE(min_connections > 0);
+	REQUIRE(max_connections >= min_connections);
 
 	pool = isc_mem_get(mctx, sizeof(*pool));
 	ZERO_PTR(pool);
 	isc_mem_attach(mctx, &pool->mctx);
-	
-	CHECK(semaphore_init(&pool->conn_semaphore, connections));
+
+	/* isc_mutex_init and isc_condition_init failures are now fatal */
+	isc_mutex_init(&pool->lock);
+	isc_condition_init(&pool->cond);
+	isc_condition_init(&pool->connector_cond);
 	pool->conns = isc_mem_get(mctx,
-				  connections * sizeof(ldap_connection_t *));
-	memset(pool->conns, 0, connections * sizeof(ldap_connection_t *));
-	pool->connections = connections;
+				  max_connections * sizeof(ldap_connection_t *));
+	memset(pool->conns, 0, max_connections * sizeof(ldap_connection_t *));
+	pool->idle = isc_mem_get(mctx,
+				 max_connections * sizeof(ldap_connection_t *));
+	memset(pool->idle, 0, max_connections * sizeof(ldap_connection_t *));
+	pool->min_connections = min_connections;
+	pool->max_connections = max_connections;
+	pool->idle_timeout = idle_timeout;
+	pool->check_interval = check_interval;
+	isc_time_settoepoch(&pool->next_grow);
 
 	*poolp = pool;
 
 	return ISC_R_SUCCESS;
-
-cleanup:
-	ldap_pool_destroy(&pool);
-	return result;
 }
 
 static void ATTR_NONNULLS
@@ -3639,6 +4558,23 @@ ldap_pool_destroy(ldap_pool_t **poolp)
 	if (pool == NULL)
 		return;
 
+	if (pool->connector_running == true) {
+		LOCK(&pool->lock);
+		pool->exiting = true;
+		SIGNAL(&pool->connector_cond);
+		UNLOCK(&pool->lock);
+		/* isc_thread_join assert internally on failure */
+		isc_thread_join(pool->connector, NULL);
+		pool->connector_running = false;
+	}
+
+	if (pool->checkouts > 0)
+		log_debug(1, "LDAP connection pool: %" PRIu64 " checkouts, "
+			  "%" PRIu64 " had to wait, total wait %" PRIu64 " us, "
+			  "max. wait %" PRIu64 " us", pool->checkouts,
+			  pool->waits, pool->wait_usec_total,
+			  pool->wait_usec_max);
+
 	if (pool->conns != NULL) {
 		for (i = 0; i < pool->connections; i++) {
 			ldap_conn = pool->conns[i];
@@ -3647,44 +4583,81 @@ ldap_pool_destroy(ldap_pool_t **poolp)
 		}
 
 		SAFE_MEM_PUT(pool->mctx, pool->conns,
-			     pool->connections * sizeof(ldap_connection_t *));
+			     pool->max_connections * sizeof(ldap_connection_t *));
 	}
+	if (pool->idle != NULL)
+		SAFE_MEM_PUT(pool->mctx, pool->idle,
+			     pool->max_connections * sizeof(ldap_connection_t *));
 
-	semaphore_destroy(&pool->conn_semaphore);
+	isc_mutex_destroy(&pool->lock);
+	RUNTIME_CHECK(isc_condition_destroy(&pool->cond) == ISC_R_SUCCESS);
+	RUNTIME_CHECK(isc_condition_destroy(&pool->connector_cond)
+		      == ISC_R_SUCCESS);
 
 	MEM_PUT_AND_DETACH(pool);
 	*poolp = NULL;
 }
 
+/**
+ * Take the most recently used idle connection from the pool. Ask
+ * the connector thread for a new connection and wait up to conn_wait_timeout
+ * if all connections are in use.
+ */
 static isc_result_t ATTR_NONNULLS ATTR_CHECKRESULT
 ldap_pool_getconnection(ldap_pool_t *pool, ldap_connection_t ** conn)
 {
 	ldap_connection_t *ldap_conn = NULL;
-	unsigned int i;
+	isc_time_t abs_timeout;
+	isc_time_t start;
+	isc_time_t now;
+	uint64_t wait_usec;
+	bool waited = false;
 	isc_result_t result;
 
 	REQUIRE(pool != NULL);
 	REQUIRE(conn != NULL && *conn == NULL);
-	ldap_conn = *conn;
 
-	CHECK(semaphore_wait_timed(&pool->conn_semaphore, &conn_wait_timeout));
-	/* Following assertion is necessary to convince clang static analyzer
-	 * that the loop is always entered. */
-	REQUIRE(pool->connections > 0);
-	for (i = 0; i < pool->connections; i++) {
-		ldap_conn = pool->conns[i];
-		if (isc_mutex_trylock(&ldap_conn->lock) == ISC_R_SUCCESS)
-			break;
+	CHECK(isc_time_nowplusinterval(&abs_timeout, &conn_wait_timeout));
+	LOCK(&pool->lock);
+	if (pool->idle_count == 0) {
+		waited = true;
+		result = isc_time_now(&start);
+		pool->waiters++;
+		if (pool->connections < pool->max_connections)
+			SIGNAL(&pool->connector_cond);
+		while (result == ISC_R_SUCCESS && pool->idle_count == 0)
+			result = WAITUNTIL(&pool->cond, &pool->lock,
+					   &abs_timeout);
+		pool->waiters--;
+		if (result != ISC_R_SUCCESS) {
+			UNLOCK(&pool->lock);
+			goto cleanup;
+		}
 	}
 
+	ldap_conn = pool->idle[--pool->idle_count];
+	pool->idle[pool->idle_count] = NULL;
+	pool->checkouts++;
+	if (waited == true && isc_time_now(&now) == ISC_R_SUCCESS) {
+		wait_usec = isc_time_microdiff(&now, &start);
+		pool->waits++;
+		pool->wait_usec_total += wait_usec;
+		if (wait_usec > pool->wait_usec_max)
+			pool->wait_usec_max = wait_usec;
+		log_debug(2, "waited %" PRIu64 " us for LDAP connection",
+			  wait_usec);
+	}
+	UNLOCK(&pool->lock);
+
 	RUNTIME_CHECK(ldap_conn != NULL);
+	LOCK(&ldap_conn->lock);
 
 	*conn = ldap_conn;
 
 cleanup:
 	if (result != ISC_R_SUCCESS) {
 		log_error("timeout in ldap_pool_getconnection(): try to raise "
-				"'connections' parameter; potential deadlock?");
+			  "'connections_max' parameter; potential deadlock?");
 	}
 	return result;
 }
@@ -3698,12 +4671,30 @@ ldap_pool_putconnection(ldap_pool_t *pool, ldap_connection_t **conn)
 	if (ldap_conn == NULL)
 		return;
 
+	if (isc_time_now(&ldap_conn->last_used) != ISC_R_SUCCESS)
+		isc_time_settoepoch(&ldap_conn->last_used);
 	UNLOCK(&ldap_conn->lock);
-	semaphore_signal(&pool->conn_semaphore);
+
+	LOCK(&pool->lock);
+	INSIST(pool->idle_count < pool->connections);
+	pool->idle[pool->idle_count++] = ldap_conn;
+	SIGNAL(&pool->cond);
+	/* New bottom of the stack, connector has to plan its expiration
+	 * and health check. */
+	if (pool->idle_count == 1 &&
+	    (pool->check_interval > 0 ||
+	     (pool->idle_timeout > 0 &&
+	      pool->connections > pool->min_connections)))
+		SIGNAL(&pool->connector_cond);
+	UNLOCK(&pool->lock);
 
 	*conn = NULL;
 }
 
+/**
+ * Open connections up to the minimal pool size and start the connector
+ * thread if the pool is allowed to grow.
+ */
 static isc_result_t ATTR_NONNULLS ATTR_CHECKRESULT
 ldap_pool_connect(ldap_pool_t *pool, ldap_instance_t *ldap_inst)
 {
@@ -3711,28 +4702,329 @@ ldap_pool_connect(ldap_pool_t *pool, ldap_instance_t *ldap_inst)
 	ldap_connection_t *ldap_conn;
 	unsigned int i;
 
-	for (i = 0; i < pool->connections; i++) {
+	pool->inst = ldap_inst;
+	for (i = 0; i < pool->min_connections; i++) {
 		ldap_conn = NULL;
 		CHECK(new_ldap_connection(pool, &ldap_conn));
+		pool->conns[i] = ldap_conn;
 		result = bdl_ldap_connect(ldap_inst, ldap_conn, false);
 		/* Continue even if LDAP server is down */
 		if (result != ISC_R_NOTCONNECTED && result != ISC_R_TIMEDOUT &&
 		    result != ISC_R_SUCCESS) {
 			goto cleanup;
 		}
-		pool->conns[i] = ldap_conn;
+		if (isc_time_now(&ldap_conn->last_used) != ISC_R_SUCCESS)
+			isc_time_settoepoch(&ldap_conn->last_used);
+		ldap_conn->last_check = ldap_conn->last_used;
+	}
+
+	/* Pool is not in use yet, so no locking is needed. */
+	for (i = 0; i < pool->min_connections; i++)
+		pool->idle[i] = pool->conns[i];
+	pool->connections = pool->min_connections;
+	pool->idle_count = pool->min_connections;
+
+	if (pool->max_connections > pool->min_connections ||
+	    pool->check_interval > 0) {
+		/* isc_thread_create assert internally on failure */
+		isc_thread_create(ldap_pool_connector, pool, &pool->connector);
+		pool->connector_running = true;
 	}
 
 	return ISC_R_SUCCESS;
 
 cleanup:
 	log_error_r("couldn't establish connection in LDAP connection pool");
-	for (i = 0; i < pool->connections; i++) {
+	for (i = 0; i < pool->min_connections; i++) {
 		destroy_ldap_connection(&pool->conns[i]);
 	}
 	return result;
 }
 
+/**
+ * Open one more connection for callers waiting in ldap_pool_getconnection().
+ * Connection which failed to connect is not added to the pool and no new
+ * connection is opened for reconnect_interval seconds.
+ *
+ * @pre pool->lock is locked. It is unlocked while the connection is being
+ *      established.
+ */
+static void ATTR_NONNULLS
+ldap_pool_grow(ldap_pool_t *pool)
+{
+	isc_result_t result;
+	ldap_connection_t *ldap_conn = NULL;
+	uint32_t reconnect_interval = 0;
+	isc_interval_t delay;
+
+	UNLOCK(&pool->lock);
+	CHECK(new_ldap_connection(pool, &ldap_conn));
+	CHECK(bdl_ldap_connect(pool->inst, ldap_conn, false));
+	if (isc_time_now(&ldap_conn->last_used) != ISC_R_SUCCESS)
+		isc_time_settoepoch(&ldap_conn->last_used);
+	ldap_conn->last_check = ldap_conn->last_used;
+
+	LOCK(&pool->lock);
+	INSIST(pool->connections < pool->max_connections);
+	pool->conns[pool->connections++] = ldap_conn;
+	pool->idle[pool->idle_count++] = ldap_conn;
+	SIGNAL(&pool->cond);
+	log_debug(1, "LDAP connection pool grew to %u connections",
+		  pool->connections);
+	return;
+
+cleanup:
+	log_error_r("unable to add connection to LDAP connection pool");
+	destroy_ldap_connection(&ldap_conn);
+	if (setting_get_uint(SETTING_RECONNECT_INTERVAL,
+			     pool->inst->server_ldap_settings,
+			     &reconnect_interval) != ISC_R_SUCCESS)
+		reconnect_interval = 60;
+	isc_interval_set(&delay, reconnect_interval, 0);
+	LOCK(&pool->lock);
+	if (isc_time_nowplusinterval(&pool->next_grow, &delay)
+	    != ISC_R_SUCCESS)
+		isc_time_settoepoch(&pool->next_grow);
+}
+
+/**
+ * Close the connection at the bottom of the idle stack if it was not used
+ * for idle_timeout seconds and the pool is larger than its minimal size.
+ *
+ * @param[out] expire Time when the connection at the bottom of the stack
+ *                    expires. Valid only if false is returned and pool
+ *                    is larger than the minimum.
+ *
+ * @retval true  A connection was closed.
+ * @retval false Nothing to close at the moment.
+ *
+ * @pre pool->lock is locked. It is unlocked while the connection
+ *      is being closed.
+ */
+static bool ATTR_NONNULLS ATTR_CHECKRESULT
+ldap_pool_reap(ldap_pool_t *pool, isc_time_t *now, isc_time_t *expire)
+{
+	ldap_connection_t *ldap_conn;
+	isc_interval_t timeout;
+	unsigned int i;
+
+	if (pool->idle_timeout == 0 || pool->idle_count == 0 ||
+	    pool->connections <= pool->min_connections)
+		return false;
+
+	ldap_conn = pool->idle[0];
+	isc_interval_set(&timeout, pool->idle_timeout, 0);
+	if (isc_time_add(&ldap_conn->last_used, &timeout, expire)
+	    != ISC_R_SUCCESS)
+		*expire = *now;
+	if (isc_time_compare(expire, now) > 0)
+		return false;
+
+	pool->idle_count--;
+	memmove(&pool->idle[0], &pool->idle[1],
+		pool->idle_count * sizeof(ldap_connection_t *));
+	pool->idle[pool->idle_count] = NULL;
+	for (i = 0; i < pool->connections; i++) {
+		if (pool->conns[i] == ldap_conn)
+			break;
+	}
+	INSIST(i < pool->connections);
+	pool->conns[i] = pool->conns[--pool->connections];
+	pool->conns[pool->connections] = NULL;
+	log_debug(1, "LDAP connection pool shrank to %u connections",
+		  pool->connections);
+
+	UNLOCK(&pool->lock);
+	if (ldap_conn->server != SERVER_NONE)
+		server_list_release(pool->inst->servers, ldap_conn->server);
+	destroy_ldap_connection(&ldap_conn);
+	LOCK(&pool->lock);
+
+	return true;
+}
+
+/**
+ * Check that the connection still works by reading root DSE and rebind
+ * it if it does not. Round-trip time of the read is reported to the server
+ * list.
+ */
+static isc_result_t ATTR_NONNULLS ATTR_CHECKRESULT
+ldap_pool_probe(ldap_instance_t *inst, ldap_connection_t *ldap_conn)
+{
+	isc_result_t result;
+	char *attrs[] = { LDAP_NO_ATTRS, NULL };
+	LDAPMessage *res = NULL;
+	struct timeval timeout;
+	uint32_t timeout_sec;
+	isc_time_t start;
+	isc_time_t now;
+	int ret;
+
+	if (ldap_conn->handle == NULL)
+		goto reconnect;
+
+	CHECK(setting_get_uint(SETTING_TIMEOUT, inst->server_ldap_settings,
+			       &timeout_sec));
+	timeout.tv_sec = timeout_sec;
+	timeout.tv_usec = 0;
+
+	if (isc_time_now(&start) != ISC_R_SUCCESS)
+		isc_time_settoepoch(&start);
+	ret = ldap_search_ext_s(ldap_conn->handle, "", LDAP_SCOPE_BASE,
+				"(objectClass=*)", attrs, 0, NULL, NULL,
+				&timeout, 1, &res);
+	ldap_msgfree(res);
+	if (ret == LDAP_SUCCESS) {
+		if (isc_time_now(&now) != ISC_R_SUCCESS)
+			now = start;
+		if (ldap_conn->server != SERVER_NONE)
+			server_list_rtt(ldap_conn_servers(inst, ldap_conn),
+					ldap_conn->server,
+					isc_time_microdiff(&now, &start));
+		return ISC_R_SUCCESS;
+	}
+	log_ldap_error(ldap_conn->handle, "health check of idle LDAP "
+		       "connection failed");
+
+reconnect:
+	result = bdl_ldap_connect(inst, ldap_conn, false);
+	if (result == ISC_R_SUCCESS)
+		log_info("successfully reconnected to LDAP server");
+
+cleanup:
+	return result;
+}
+
+/**
+ * Probe one idle connection which was neither used nor probed for
+ * check_interval seconds. The connection is taken out of the idle stack
+ * for the time of the probe and then returned back to the same position
+ * so the probe does not make it look recently used.
+ *
+ * @param[out] due Time when the next idle connection should be probed.
+ *                 Valid only if false is returned and there are idle
+ *                 connections.
+ *
+ * @retval true  A connection was probed.
+ * @retval false Nothing to probe at the moment.
+ *
+ * @pre pool->lock is locked. It is unlocked during the probe.
+ */
+static bool ATTR_NONNULLS ATTR_CHECKRESULT
+ldap_pool_check(ldap_pool_t *pool, isc_time_t *now, isc_time_t *due)
+{
+	ldap_connection_t *ldap_conn = NULL;
+	isc_interval_t interval;
+	isc_time_t *last;
+	isc_time_t conn_due;
+	unsigned int i;
+
+	if (pool->check_interval == 0 || pool->idle_count == 0)
+		return false;
+
+	isc_interval_set(&interval, pool->check_interval, 0);
+	for (i = 0; i < pool->idle_count; i++) {
+		ldap_conn = pool->idle[i];
+		if (isc_time_compare(&ldap_conn->last_used,
+				     &ldap_conn->last_check) > 0)
+			last = &ldap_conn->last_used;
+		else
+			last = &ldap_conn->last_check;
+		if (isc_time_add(last, &interval, &conn_due) != ISC_R_SUCCESS)
+			conn_due = *now;
+		if (isc_time_compare(&conn_due, now) <= 0)
+			break;
+		if (i == 0 || isc_time_compare(&conn_due, due) < 0)
+			*due = conn_due;
+	}
+	if (i == pool->idle_count)
+		return false;
+
+	memmove(&pool->idle[i], &pool->idle[i + 1],
+		(pool->idle_count - i - 1) * sizeof(ldap_connection_t *));
+	pool->idle[--pool->idle_count] = NULL;
+	UNLOCK(&pool->lock);
+
+	LOCK(&ldap_conn->lock);
+	if (ldap_pool_probe(pool->inst, ldap_conn) != ISC_R_SUCCESS)
+		log_error("LDAP connection is not usable, it will be "
+			  "checked again in %u seconds", pool->check_interval);
+	if (isc_time_now(&ldap_conn->last_check) != ISC_R_SUCCESS)
+		ldap_conn->last_check = *now;
+	UNLOCK(&ldap_conn->lock);
+
+	LOCK(&pool->lock);
+	i = ISC_MIN(i, pool->idle_count);
+	memmove(&pool->idle[i + 1], &pool->idle[i],
+		(pool->idle_count - i) * sizeof(ldap_connection_t *));
+	pool->idle[i] = ldap_conn;
+	pool->idle_count++;
+	SIGNAL(&pool->cond);
+
+	return true;
+}
+
+/**
+ * Connector thread grows the pool on demand and shrinks it back
+ * when connections stay idle. Establishing a connection blocks only this
+ * thread, callers of ldap_pool_getconnection() keep waiting for whichever
+ * connection becomes available first.
+ *
+ * Idle connections are probed periodically and rebound if they stopped
+ * working so callers do not have to reconnect while serving an update.
+ */
+static isc_threadresult_t
+ldap_pool_connector(isc_threadarg_t arg)
+{
+	ldap_pool_t *pool = (ldap_pool_t *)arg;
+	isc_time_t now;
+	isc_time_t expire;
+	isc_time_t wakeup;
+	bool timed;
+
+	LOCK(&pool->lock);
+	while (pool->exiting == false) {
+		RUNTIME_CHECK(isc_time_now(&now) == ISC_R_SUCCESS);
+		timed = false;
+
+		if (pool->waiters > pool->idle_count &&
+		    pool->connections < pool->max_connections) {
+			if (isc_time_compare(&now, &pool->next_grow) >= 0) {
+				ldap_pool_grow(pool);
+				continue;
+			}
+			wakeup = pool->next_grow;
+			timed = true;
+		}
+
+		if (ldap_pool_reap(pool, &now, &expire) == true)
+			continue;
+		if (pool->idle_timeout > 0 && pool->idle_count > 0 &&
+		    pool->connections > pool->min_connections &&
+		    (timed == false || isc_time_compare(&expire, &wakeup) < 0)) {
+			wakeup = expire;
+			timed = true;
+		}
+
+		if (ldap_pool_check(pool, &now, &expire) == true)
+			continue;
+		if (pool->check_interval > 0 && pool->idle_count > 0 &&
+		    (timed == false || isc_time_compare(&expire, &wakeup) < 0)) {
+			wakeup = expire;
+			timed = true;
+		}
+
+		if (timed == true)
+			(void)WAITUNTIL(&pool->connector_cond, &pool->lock,
+					&wakeup);
+		else
+			WAIT(&pool->connector_cond, &pool->lock);
+	}
+	UNLOCK(&pool->lock);
+
+	return (isc_threadresult_t)0;
+}
+
 #define LDAP_ENTRYCHANGE_ALL	(LDAP_SYNC_CAPI_ADD | LDAP_SYNC_CAPI_DELETE | LDAP_SYNC_CAPI_MODIFY)
 
 #define SYNCREPL_ADD(chgtype) (chgtype == LDAP_SYNC_CAPI_ADD)
@@ -3877,7 +5169,7 @@ update_record(isc_task_t *task, isc_event_t *event)
 	isc_result_t result;
 	ldap_instance_t *inst = pevent->inst;
 	isc_mem_t *mctx;
-	settings_set_t *zone_settings = NULL;
+	zone_handle_t *zone = pevent->zone;
 	dns_zone_t *raw = NULL;
 	dns_zone_t *secure = NULL;
 	bool zone_found = false;
@@ -3913,15 +5205,19 @@ update_record(isc_task_t *task, isc_event_t *event)
 	dns_name_init(&prevorigin, NULL);
 
 	REQUIRE(inst != NULL);
-	CHECK(zr_get_zone_ptr(inst->zone_register, &entry->zone_name, &raw, &secure));
+	REQUIRE(zone != NULL);
+	/* Zone, databases and settings were looked up in syncrepl_update()
+	 * and stay valid as long as the handle is attached. */
+	if (zone->removed == true)
+		CLEANUP_WITH(ISC_R_NOTFOUND);
+	raw = zone->raw;
+	secure = zone->secure;
+	rbtdb = zone->rbtdb;
+	ldapdb = zone->ldapdb;
 	zone_found = true;
 
 update_restart:
-	rbtdb = NULL;
-	ldapdb = NULL;
-	zone_settings = NULL;
 	ldapdb_rdatalist_destroy(mctx, &rdatalist);
-	CHECK(zr_get_zone_dbs(inst->zone_register, &entry->zone_name, &ldapdb, &rbtdb));
 	CHECK(dns_db_newversion(ldapdb, &version));
 
 	CHECK(dns_db_findnode(rbtdb, &entry->fqdn, true, &node));
@@ -3972,10 +5268,8 @@ update_restart:
 		/* Parse new data from LDAP. */
 		log_debug(5, "syncrepl_update: updating name in rbtdb, "
 			  "%s", ldap_entry_logname(entry));
-		CHECK(zr_get_zone_settings(inst->zone_register,
-					   &entry->zone_name, &zone_settings));
 		CHECK(ldap_parse_rrentry(mctx, entry, &entry->zone_name,
-					 zone_settings, &rdatalist));
+					 zone->settings, &rdatalist));
 	}
 
 	if (rbt_rds_iterator != NULL) {
@@ -3993,7 +5287,8 @@ update_restart:
 			dns_zone_log(raw, ISC_LOG_DEBUG(5),
 				     "writing new zone serial %u to LDAP",
 				     serial);
-			result = ldap_replace_serial(inst, &entry->zone_name, serial);
+			result = ldap_serial_writeback(inst, &entry->zone_name,
+						       serial);
 			if (result != ISC_R_SUCCESS)
 				dns_zone_log(raw, ISC_LOG_ERROR,
 					     "serial (%u) write back to LDAP failed",
@@ -4034,10 +5329,6 @@ cleanup:
 	/* rollback */
 	if (rbtdb != NULL && version != NULL)
 		dns_db_closeversion(ldapdb, &version, false);
-	if (rbtdb != NULL)
-		dns_db_detach(&rbtdb);
-	if (ldapdb != NULL)
-		dns_db_detach(&ldapdb);
 	if (result != ISC_R_SUCCESS && zone_found && !zone_reloaded &&
 	   (result == DNS_R_NOTLOADED || result == DNS_R_BADZONE)) {
 		dns_zone_log(raw, ISC_LOG_DEBUG(1),
@@ -4079,10 +5370,7 @@ cleanup:
 	if (dns_name_dynamic(&prevorigin))
 		dns_name_free(&prevorigin, inst->mctx);
 
-	if (raw != NULL)
-		dns_zone_detach(&raw);
-	if (secure != NULL)
-		dns_zone_detach(&secure);
+	zone_handle_detach(&pevent->zone);
 	ldapdb_rdatalist_destroy(mctx, &rdatalist);
 	if (pevent->prevdn != NULL)
 		isc_mem_free(mctx, pevent->prevdn);
@@ -4134,6 +5422,65 @@ cleanup:
 	return result;
 }
 
+/**
+ * Publish zones queued by update_zone(), see publish_pending_zones().
+ */
+static void ATTR_NONNULLS
+publish_flush(isc_task_t *task, isc_event_t *event)
+{
+	ldap_syncreplevent_t *pevent = (ldap_syncreplevent_t *)event;
+	ldap_instance_t *inst = pevent->inst;
+	isc_mem_t *mctx = pevent->mctx;
+
+	INSIST(task == inst->task); /* For task-exclusive mode */
+
+	publish_pending_zones(inst);
+
+	sync_event_signal(inst->sctx, pevent);
+	isc_mem_detach(&mctx);
+	isc_event_free(&event);
+	isc_task_detach(&task);
+}
+
+/**
+ * Ask inst->task to publish queued zones and wait until the zones
+ * are published and loaded.
+ *
+ * Zones created by update_zone() are queued until the syncrepl watcher
+ * processed all changes received from LDAP so far (refresh phase or one
+ * ldap_sync_poll() call). A record for a queued zone publishes the queue
+ * immediately.
+ */
+static isc_result_t ATTR_NONNULLS ATTR_CHECKRESULT
+publish_pending_send(ldap_instance_t *inst)
+{
+	ldap_syncreplevent_t *pevent = NULL;
+	isc_task_t *task = NULL;
+	bool empty;
+
+	LOCK(&inst->publish_lock);
+	empty = EMPTY(inst->publish_queue);
+	UNLOCK(&inst->publish_lock);
+	if (empty == true)
+		return ISC_R_SUCCESS;
+
+	isc_task_attach(inst->task, &task);
+	pevent = (ldap_syncreplevent_t *)isc_event_allocate(inst->mctx,
+				inst, LDAPDB_EVENT_ZONE_PUBLISH,
+				publish_flush, NULL,
+				sizeof(ldap_syncreplevent_t));
+	pevent->mctx = NULL;
+	isc_mem_attach(inst->mctx, &pevent->mctx);
+	pevent->inst = inst;
+	pevent->prevdn = NULL;
+	pevent->chgtype = 0;
+	pevent->entry = NULL;
+	pevent->zone = NULL;
+
+	/* The event handler detaches the task. */
+	return sync_event_send(inst->sctx, task, &pevent, true);
+}
+
 /**
  * Create asynchronous ISC event to execute update_config()/zone()/record()
  * in a task associated with affected DNS zone.
@@ -4152,7 +5499,7 @@ syncrepl_update(ldap_instance_t *inst, ldap_entry_t **entryp, int chgtype)
 	ldap_syncreplevent_t *pevent = NULL;
 	ldap_entry_t *entry = NULL;
 	dns_name_t *zone_name = NULL;
-	dns_zone_t *zone_ptr = NULL;
+	zone_handle_t *zone = NULL;
 	isc_taskaction_t action = NULL;
 	isc_task_t *task = NULL;
 	bool synchronous;
@@ -4176,9 +5523,14 @@ syncrepl_update(ldap_instance_t *inst, ldap_entry_t **entryp, int chgtype)
 	 * See discussion about run_exclusive_begin() function in lock.c. */
 	if ((entry->class & LDAP_ENTRYCLASS_RR) != 0 &&
 	    (entry->class & LDAP_ENTRYCLASS_MASTER) == 0) {
-		CHECK(zr_get_zone_ptr(inst->zone_register, zone_name,
-				      &zone_ptr, NULL));
-		dns_zone_gettask(zone_ptr, &task);
+		/* The handle is passed to update_record() so the zone
+		 * register is searched only once per record. */
+		CHECK(zr_get_zone_handle(inst->zone_register, zone_name,
+					 &zone));
+		/* Zone has to be loaded before records are applied to it. */
+		if (publish_zone_ispending(inst, zone) == true)
+			CHECK(publish_pending_send(inst));
+		isc_task_attach(zone->task, &task);
 		synchronous = false;
 	} else {
 		/* For configuration object and zone object use single task
@@ -4222,6 +5574,8 @@ syncrepl_update(ldap_instance_t *inst, ldap_entry_t **entryp, int chgtype)
 	pevent->prevdn = NULL;
 	pevent->chgtype = chgtype;
 	pevent->entry = entry;
+	pevent->zone = zone;
+	zone = NULL;
 
 	/* Lock syncrepl queue to prevent zone, config and resource records
 	 * from racing with each other. */
@@ -4229,8 +5583,7 @@ syncrepl_update(ldap_instance_t *inst, ldap_entry_t **entryp, int chgtype)
 	*entryp = NULL; /* event handler will deallocate the LDAP entry */
 
 cleanup:
-	if (zone_ptr != NULL)
-		dns_zone_detach(&zone_ptr);
+	zone_handle_detach(&zone);
 	if (result != ISC_R_SUCCESS)
 		log_error_r("syncrepl_update failed for %s",
 			    ldap_entry_logname(entry));
@@ -4239,6 +5592,7 @@ cleanup:
 		sync_concurr_limit_signal(inst->sctx);
 		if (pevent->mctx != NULL)
 			isc_mem_detach(&pevent->mctx);
+		zone_handle_detach(&pevent->zone);
 		ldap_entry_destroy(entryp);
 		if (task != NULL)
 			isc_task_detach(&task);
@@ -4271,6 +5625,56 @@ sane_sleep(const ldap_instance_t *inst, unsigned int timeout)
 	return inst->exiting ? false : true;
 }
 
+/**
+ * Token bucket which limits how often the watcher starts full
+ * resynchronization with LDAP. One token is added every resync_interval
+ * seconds up to RESYNC_BURST tokens. If the bucket is empty, the watcher
+ * waits for the next token plus a random delay of up to half of
+ * the interval so DNS servers which lost connection to the same LDAP
+ * server at the same moment do not start refreshes at the same time.
+ *
+ * @param[in,out] tokens Number of tokens in the bucket.
+ * @param[in,out] refill Time when the last token was added.
+ *
+ * @retval false Instance is exiting.
+ */
+static bool ATTR_NONNULLS ATTR_CHECKRESULT
+resync_throttle(ldap_instance_t *inst, unsigned int *tokens, time_t *refill)
+{
+	uint32_t interval;
+	unsigned int delay;
+	time_t now;
+
+	if (setting_get_uint(SETTING_RESYNC_INTERVAL, inst->local_settings,
+			     &interval) != ISC_R_SUCCESS || interval == 0)
+		return true;
+
+	now = time(NULL);
+	while (*tokens < RESYNC_BURST && now - *refill >= (time_t)interval) {
+		(*tokens)++;
+		*refill += interval;
+	}
+	if (*tokens == RESYNC_BURST)
+		*refill = now;
+
+	if (*tokens > 0) {
+		(*tokens)--;
+		return true;
+	}
+
+	delay = (unsigned int)(*refill + interval - now)
+		+ random_uniform(interval / 2 + 1);
+	log_info("full synchronization with LDAP is delayed by %u second%s "
+		 "to spread load on LDAP servers", delay,
+		 delay == 1 ? "": "s");
+	if (!sane_sleep(inst, delay))
+		return false;
+	/* The new token is consumed right away. */
+	*refill += interval;
+
+	return true;
+}
+
 /* No-op signal handler for SIGUSR1 */
 static void
 noop_handler(int signal)
@@ -4301,63 +5705,395 @@ install_usr1handler(void)
 	once = true;
 }
 
-/*
- * Called when a reference is returned by ldap_sync_init()/ldap_sync_poll().
- */
-static int ATTR_NONNULLS ATTR_CHECKRESULT
-ldap_sync_search_reference (
-	ldap_sync_t			*ls,
-	LDAPMessage			*msg ) {
+/* Registry of syncrepl sessions shared by instances, see sync_share_join(). */
+static pthread_mutex_t sync_shares_lock = PTHREAD_MUTEX_INITIALIZER;
+static ISC_LIST(sync_share_t) sync_shares = { NULL, NULL };
 
-	UNUSED(ls);
+/**
+ * Settings which determine content of syncrepl stream. Instances with
+ * the same values receive the same data from LDAP.
+ */
+static const setting_id_t sync_share_settings[] = {
+	SETTING_URI, SETTING_WATCHER_URI, SETTING_BASE, SETTING_AUTH_METHOD,
+	SETTING_BIND_DN, SETTING_WATCHER_BIND_DN, SETTING_SASL_USER,
+	SETTING_KRB5_PRINCIPAL, SETTING_SERVER_ID, SETTING_COUNT
+};
+
+static isc_result_t ATTR_NONNULLS ATTR_CHECKRESULT
+sync_share_key(ldap_instance_t *inst, ld_string_t *key)
+{
+	isc_result_t result;
+	const setting_id_t *id;
+	const char *value = NULL;
+
+	for (id = sync_share_settings; *id != SETTING_COUNT; id++) {
+		CHECK(setting_get_str(*id, inst->local_settings, &value));
+		CHECK(str_cat_char(key, value));
+		CHECK(str_cat_char(key, "\n"));
+	}
+
+cleanup:
+	return result;
+}
+
+/**
+ * Add instance to the syncrepl session shared with other instances
+ * if shared_sync is enabled. The first instance with given LDAP servers,
+ * base, credentials and server_id becomes leader and its watcher runs
+ * the session for all members. Watchers of other members sleep until
+ * the leader leaves.
+ *
+ * Leader of existing session is interrupted so it starts a new session
+ * and the new member receives full refresh.
+ */
+static isc_result_t ATTR_NONNULLS ATTR_CHECKRESULT
+sync_share_join(ldap_instance_t *inst)
+{
+	isc_result_t result;
+	bool shared;
+	ld_string_t *key = NULL;
+	sync_share_t *share;
+	ldap_instance_t *leader;
+
+	REQUIRE(inst->share == NULL);
+
+	CHECK(setting_get_bool(SETTING_SHARED_SYNC, inst->local_settings,
+			       &shared));
+	if (shared == false)
+		return ISC_R_SUCCESS;
+
+	CHECK(str_new(inst->mctx, &key));
+	CHECK(sync_share_key(inst, key));
+
+	RUNTIME_CHECK(pthread_mutex_lock(&sync_shares_lock) == 0);
+	for (share = HEAD(sync_shares);
+	     share != NULL && strcmp(share->key, str_buf(key)) != 0;
+	     share = NEXT(share, link))
+		;
+	if (share == NULL) {
+		share = isc_mem_get(inst->mctx, sizeof(*share));
+		ZERO_PTR(share);
+		isc_mem_attach(inst->mctx, &share->mctx);
+		share->key = isc_mem_strdup(share->mctx, str_buf(key));
+		/* isc_mutex_init failures are now fatal */
+		isc_mutex_init(&share->lock);
+		INIT_LIST(share->members);
+		INIT_LINK(share, link);
+		APPEND(sync_shares, share, link);
+	}
+
+	LOCK(&share->lock);
+	leader = HEAD(share->members);
+	INIT_LINK(inst, share_link);
+	APPEND(share->members, inst, share_link);
+	inst->share = share;
+	inst->share_active = false;
+	if (leader != NULL) {
+		log_info("instance '%s' shares LDAP synchronization "
+			 "with instance '%s'", inst->db_name, leader->db_name);
+		share->resync = true;
+		if (leader->watcher != 0 &&
+		    pthread_kill(leader->watcher, SIGUSR1) != 0)
+			log_error("unable to send signal to SyncRepl watcher "
+				  "thread of instance '%s'", leader->db_name);
+	}
+	UNLOCK(&share->lock);
+	RUNTIME_CHECK(pthread_mutex_unlock(&sync_shares_lock) == 0);
+
+cleanup:
+	str_destroy(&key);
+	return result;
+}
+
+/**
+ * Remove instance from shared syncrepl session. Watcher of the instance
+ * has to be stopped already. If the instance was leader, watcher of the next
+ * member takes over.
+ */
+static void ATTR_NONNULLS
+sync_share_leave(ldap_instance_t *inst)
+{
+	sync_share_t *share = inst->share;
+	bool empty;
+
+	if (share == NULL)
+		return;
+
+	RUNTIME_CHECK(pthread_mutex_lock(&sync_shares_lock) == 0);
+	/* Waits until leader finishes processing of the current message. */
+	LOCK(&share->lock);
+	UNLINK(share->members, inst, share_link);
+	inst->share = NULL;
+	empty = EMPTY(share->members);
+	UNLOCK(&share->lock);
+	if (empty == true) {
+		UNLINK(sync_shares, share, link);
+		isc_mem_free(share->mctx, share->key);
+		isc_mutex_destroy(&share->lock);
+		MEM_PUT_AND_DETACH(share);
+	}
+	RUNTIME_CHECK(pthread_mutex_unlock(&sync_shares_lock) == 0);
+}
+
+/**
+ * @retval true Watcher of the instance should run syncrepl session.
+ */
+static bool ATTR_NONNULLS ATTR_CHECKRESULT
+sync_share_isleader(ldap_instance_t *inst)
+{
+	bool leader;
+
+	if (inst->share == NULL)
+		return true;
+
+	LOCK(&inst->share->lock);
+	leader = (HEAD(inst->share->members) == inst);
+	UNLOCK(&inst->share->lock);
+
+	return leader;
+}
+
+/**
+ * @param[in] clear Reset the request after reading it.
+ *
+ * @retval true New member joined and syncrepl session has to be restarted.
+ */
+static bool ATTR_NONNULLS ATTR_CHECKRESULT
+sync_share_resync(ldap_instance_t *inst, bool clear)
+{
+	bool resync;
+
+	if (inst->share == NULL)
+		return false;
+
+	LOCK(&inst->share->lock);
+	resync = inst->share->resync;
+	if (clear == true)
+		inst->share->resync = false;
+	UNLOCK(&inst->share->lock);
+
+	return resync;
+}
+
+static void ATTR_NONNULLS
+sync_share_lock(ldap_instance_t *inst)
+{
+	if (inst->share != NULL)
+		LOCK(&inst->share->lock);
+}
+
+static void ATTR_NONNULLS
+sync_share_unlock(ldap_instance_t *inst)
+{
+	if (inst->share != NULL)
+		UNLOCK(&inst->share->lock);
+}
+
+/**
+ * Iterate over instances which receive data from syncrepl session
+ * of the leader. Instance without shared session is the only member.
+ * Members which are exiting or which joined after the session started
+ * are skipped.
+ *
+ * @pre Share lock is held, see sync_share_lock().
+ *
+ * @param[in] member NULL to get the first member.
+ */
+static ldap_instance_t * ATTR_NONNULL(1) ATTR_CHECKRESULT
+sync_share_next(ldap_instance_t *inst, ldap_instance_t *member)
+{
+	if (inst->share == NULL)
+		return (member == NULL) ? inst : NULL;
+
+	if (member == NULL)
+		member = HEAD(inst->share->members);
+	else
+		member = NEXT(member, share_link);
+	while (member != NULL &&
+	       (member->exiting == true || member->share_active == false))
+		member = NEXT(member, share_link);
+
+	return member;
+}
+
+/**
+ * Publish zones queued by all members of syncrepl session,
+ * see publish_pending_send().
+ */
+static void ATTR_NONNULLS
+sync_share_publish(ldap_instance_t *inst)
+{
+	isc_result_t result;
+	ldap_instance_t *member;
+
+	sync_share_lock(inst);
+	for (member = sync_share_next(inst, NULL);
+	     member != NULL;
+	     member = sync_share_next(inst, member)) {
+		result = publish_pending_send(member);
+		if (result != ISC_R_SUCCESS)
+			log_error_r("cannot publish new zones of instance '%s'",
+				    member->db_name);
+	}
+	sync_share_unlock(inst);
+}
+
+/**
+ * Start synchronization of members of syncrepl session.
+ * Members which joined since the last session are activated.
+ *
+ * @pre Share lock is held, see sync_share_lock().
+ *
+ * @param[in] data False before configuration is synchronized,
+ *                 true before data are synchronized.
+ */
+static isc_result_t ATTR_NONNULLS ATTR_CHECKRESULT
+sync_share_start(ldap_instance_t *inst, bool data)
+{
+	isc_result_t result;
+	ldap_instance_t *member;
+	sync_state_t state;
+
+	if (inst->share != NULL && data == false) {
+		for (member = HEAD(inst->share->members);
+		     member != NULL;
+		     member = NEXT(member, share_link))
+			member->share_active = true;
+	}
+
+	for (member = sync_share_next(inst, NULL);
+	     member != NULL;
+	     member = sync_share_next(inst, member)) {
+		sync_state_get(member->sctx, &state);
+		if (state != sync_finished) {
+			/* Cookie cannot be used, the member needs all data. */
+			if (data == false) {
+				sync_state_reset(member->sctx);
+				ldap_sync_cookies_clear(inst);
+			}
+			result = sync_task_add(member->sctx, member->task);
+			if (result != ISC_R_SUCCESS) {
+				log_error_r("cannot start synchronization "
+					    "of instance '%s'",
+					    member->db_name);
+				if (member == inst)
+					goto cleanup;
+			}
+		}
+		if (data == true) {
+			mldap_cur_generation_bump(member->mldapdb);
+			log_info("LDAP data for instance '%s' are being "
+				 "synchronized, please ignore message "
+				 "'all zones loaded'", member->db_name);
+		}
+	}
+	result = ISC_R_SUCCESS;
+
+cleanup:
+	return result;
+}
+
+/*
+ * Called when a reference is returned by ldap_sync_init()/ldap_sync_poll().
+ */
+static int ATTR_NONNULLS ATTR_CHECKRESULT
+ldap_sync_search_reference (
+	ldap_sync_t			*ls,
+	LDAPMessage			*msg ) {
+
+	UNUSED(ls);
 	UNUSED(msg);
 
 	log_error("ldap_sync_search_reference is not yet handled");
 	return LDAP_SUCCESS;
 }
 
-/*
- * Called when an entry is returned by ldap_sync_init()/ldap_sync_poll().
- * If phase is LDAP_SYNC_CAPI_ADD or LDAP_SYNC_CAPI_MODIFY,
- * the entry has been either added or modified, and thus
- * the complete view of the entry should be in the LDAPMessage.
- * If phase is LDAP_SYNC_CAPI_PRESENT or LDAP_SYNC_CAPI_DELETE,
- * only the DN should be in the LDAPMessage.
+/**
+ * Check if the entry received from LDAP is an echo of a change written
+ * to LDAP by this server, i.e. RBTDB already contains the same data.
+ *
+ * Only plain records are considered. Record values are compared
+ * in textual form so values written by somebody else in a different format
+ * are never mistaken for an echo.
  */
-int ldap_sync_search_entry (
-	ldap_sync_t			*ls,
-	LDAPMessage			*msg,
-	struct berval			*entryUUID,
-	ldap_sync_refresh_t		phase ) {
+static bool ATTR_NONNULLS ATTR_CHECKRESULT
+syncrepl_isecho(ldap_instance_t *inst, ldap_entry_t *entry)
+{
+	isc_result_t result;
+	settings_set_t *zone_settings = NULL;
+	ldap_attribute_t *attr = NULL;
+	ldap_value_t *value;
+	dns_rdatatype_t rdtype;
+	echo_digest_t digest;
 
-	ldap_instance_t *inst = ls->ls_private;
+	if (entry->class != LDAP_ENTRYCLASS_RR ||
+	    echo_filter_expects(inst->echo_filter, &entry->fqdn) == false)
+		return false;
+
+	CHECK(zr_get_zone_settings(inst->zone_register, &entry->zone_name,
+				   &zone_settings));
+	echo_digest_init(&digest);
+	for (result = ldap_entry_firstrdtype(entry, &attr, &rdtype);
+	     result == ISC_R_SUCCESS;
+	     result = ldap_entry_nextrdtype(entry, &attr, &rdtype)) {
+		for (value = HEAD(attr->values);
+		     value != NULL;
+		     value = NEXT(value, link))
+			echo_digest_value(&digest, rdtype, value->value,
+					  strlen(value->value));
+	}
+	echo_digest_ttl(&digest, ldap_entry_getttl(entry, zone_settings));
+
+	return echo_filter_match(inst->echo_filter, &entry->fqdn, digest);
+
+cleanup:
+	return false;
+}
+
+/**
+ * Apply entry received from LDAP to one instance.
+ *
+ * The entry is parsed separately for each instance sharing the syncrepl
+ * session because parsed entries are owned by events of the instance.
+ *
+ * @param[in] ld  LDAP handle, can be NULL if phase is LDAP_SYNC_CAPI_DELETE
+ *                or LDAP_SYNC_CAPI_PRESENT.
+ * @param[in] msg Entry, can be NULL if phase is LDAP_SYNC_CAPI_DELETE
+ *                or LDAP_SYNC_CAPI_PRESENT.
+ */
+static void ATTR_NONNULL(1,4)
+ldap_sync_entry_process(ldap_instance_t *inst, LDAP *ld, LDAPMessage *msg,
+			struct berval *entryUUID, ldap_sync_refresh_t phase)
+{
 	ldap_entry_t *old_entry = NULL;
 	ldap_entry_t *new_entry = NULL;
 	isc_result_t result;
-	metadb_node_t *node = NULL;
-	bool mldap_open = false;
 	bool modrdn = false;
+	bool slot = false;
 
 #ifdef RBTDB_DEBUG
 	static unsigned int count = 0;
 #endif
 
 	if (inst->exiting)
-		return LDAP_SUCCESS;
-
-	CHECK(mldap_newversion(inst->mldapdb));
-	mldap_open = true;
+		return;
 
-	CHECK(sync_concurr_limit_wait(inst->sctx));
 	log_debug(20, "ldap_sync_search_entry phase: %x", phase);
 
+	if (phase == LDAP_SYNC_CAPI_PRESENT) {
+		/* Entry did not change since the cookie, keep it alive.
+		 * No event is sent so no slot in the queue is needed. */
+		CHECK(mldap_entry_touch(inst->mldapdb, entryUUID));
+		goto cleanup;
+	}
+
 	/* MODIFY can be rename: get old name from metaDB */
 	if (phase == LDAP_SYNC_CAPI_DELETE || phase == LDAP_SYNC_CAPI_MODIFY) {
 		CHECK(ldap_entry_reconstruct(inst->mctx, inst->mldapdb,
 					     entryUUID, &old_entry));
 	}
 	if (phase == LDAP_SYNC_CAPI_ADD || phase == LDAP_SYNC_CAPI_MODIFY) {
-		CHECK(ldap_entry_parse(inst->mctx, ls->ls_ld, msg, entryUUID,
+		CHECK(ldap_entry_parse(inst->mctx, ld, msg, entryUUID,
 				       &new_entry));
 	}
 	/* detect type of modification */
@@ -4385,6 +6121,12 @@ int ldap_sync_search_entry (
 					ldap_entry_logname(new_entry));
 		}
 	}
+
+	/* Entry is parsed before waiting for a free slot in the queue
+	 * so parsing overlaps with processing of events sent earlier. */
+	CHECK(sync_concurr_limit_wait(inst->sctx));
+	slot = true;
+
 	if (phase == LDAP_SYNC_CAPI_DELETE || modrdn == true) {
 		/* delete old entry from zone and metaDB */
 		CHECK(syncrepl_update(inst, &old_entry, LDAP_SYNC_CAPI_DELETE));
@@ -4392,20 +6134,18 @@ int ldap_sync_search_entry (
 	}
 	if (phase == LDAP_SYNC_CAPI_ADD || phase == LDAP_SYNC_CAPI_MODIFY) {
 		/* store new state into metaDB */
-		CHECK(mldap_entry_create(new_entry, inst->mldapdb, &node));
-		if ((new_entry->class
-		    & (LDAP_ENTRYCLASS_CONFIG | LDAP_ENTRYCLASS_SERVERCONFIG))
-		    == 0)
-			CHECK(mldap_dnsname_store(&new_entry->fqdn,
-						  &new_entry->zone_name, node));
-		/* commit new entry into metaLDAP DB before something breaks */
-		metadb_node_close(&node);
-		mldap_closeversion(inst->mldapdb, true);
-		mldap_open = false;
-		/* re-add entry under new DN, if necessary */
-		CHECK(syncrepl_update(inst, &new_entry,
-		                      (modrdn == true)
+		CHECK(mldap_entry_create(new_entry, inst->mldapdb));
+		if (modrdn == false && syncrepl_isecho(inst, new_entry)) {
+			/* RBTDB already contains our own change */
+			log_debug(5, "dropping syncrepl echo of own write: %s",
+				  ldap_entry_logname(new_entry));
+			sync_concurr_limit_signal(inst->sctx);
+		} else {
+			/* re-add entry under new DN, if necessary */
+			CHECK(syncrepl_update(inst, &new_entry,
+					      (modrdn == true)
 					      ? LDAP_SYNC_CAPI_ADD : phase));
+		}
 	}
 	if (phase != LDAP_SYNC_CAPI_ADD && phase != LDAP_SYNC_CAPI_MODIFY &&
 	    phase != LDAP_SYNC_CAPI_DELETE) {
@@ -4420,17 +6160,45 @@ int ldap_sync_search_entry (
 #endif
 
 cleanup:
-	metadb_node_close(&node);
-	if (mldap_open == true)
-		/* commit metaDB changes if the syncrepl event was sent */
-		mldap_closeversion(inst->mldapdb, (result == ISC_R_SUCCESS));
 	if (result != ISC_R_SUCCESS) {
 		log_error_r("ldap_sync_search_entry failed");
-		sync_concurr_limit_signal(inst->sctx);
+		if (slot == true)
+			sync_concurr_limit_signal(inst->sctx);
 		/* TODO: Add 'tainted' flag to the LDAP instance. */
 	}
 	ldap_entry_destroy(&old_entry);
 	ldap_entry_destroy(&new_entry);
+}
+
+/*
+ * Called when an entry is returned by ldap_sync_init()/ldap_sync_poll().
+ * If phase is LDAP_SYNC_CAPI_ADD or LDAP_SYNC_CAPI_MODIFY,
+ * the entry has been either added or modified, and thus
+ * the complete view of the entry should be in the LDAPMessage.
+ * If phase is LDAP_SYNC_CAPI_PRESENT or LDAP_SYNC_CAPI_DELETE,
+ * only the DN should be in the LDAPMessage.
+ *
+ * The entry is applied to all instances sharing the syncrepl session.
+ */
+int ldap_sync_search_entry (
+	ldap_sync_t			*ls,
+	LDAPMessage			*msg,
+	struct berval			*entryUUID,
+	ldap_sync_refresh_t		phase ) {
+
+	ldap_instance_t *inst = ls->ls_private;
+	ldap_instance_t *member;
+
+	if (phase == LDAP_SYNC_CAPI_PRESENT)
+		inst->sync_present = true;
+
+	sync_share_lock(inst);
+	for (member = sync_share_next(inst, NULL);
+	     member != NULL;
+	     member = sync_share_next(inst, member))
+		ldap_sync_entry_process(member, ls->ls_ld, msg, entryUUID,
+					phase);
+	sync_share_unlock(inst);
 
 	/* Following return code will never reach upper layers.
 	 * It is limitation in ldap_sync_init() and ldap_sync_poll()
@@ -4438,6 +6206,54 @@ cleanup:
 	return LDAP_SUCCESS;
 }
 
+/**
+ * Finish refresh phase of data synchronization for one instance:
+ * wait until all events were processed and delete entries which
+ * were not present in LDAP.
+ *
+ * @param[in] sweep False if the session was resumed from a cookie and
+ *                  deleted entries were sent explicitly by LDAP server.
+ *                  Entries which did not change are not sent at all
+ *                  in that case so they must not be deleted.
+ */
+static void ATTR_NONNULLS
+ldap_sync_refresh_done(ldap_instance_t *inst, bool sweep)
+{
+	isc_result_t	result;
+	mldap_iter_t mldap_iter;
+	char entryUUID_buf[16];
+	struct berval entryUUID = { .bv_len = sizeof(entryUUID_buf),
+				    .bv_val = entryUUID_buf };
+	sync_state_t state;
+
+	if (inst->exiting)
+		return;
+
+	sync_state_get(inst->sctx, &state);
+	if (state == sync_datainit) {
+		result = sync_barrier_wait(inst->sctx, inst);
+		if (result != ISC_R_SUCCESS) {
+			log_error_r("%s: sync_barrier_wait() failed for "
+				    "instance '%s'", __func__, inst->db_name);
+			return;
+		}
+	}
+	if (sweep == false)
+		return;
+
+	for (result = mldap_iter_deadnodes_start(inst->mldapdb, &mldap_iter,
+						 &entryUUID);
+	     result == ISC_R_SUCCESS;
+	     result = mldap_iter_deadnodes_next(inst->mldapdb, &mldap_iter,
+					        &entryUUID)) {
+		ldap_sync_entry_process(inst, NULL, NULL, &entryUUID,
+					LDAP_SYNC_CAPI_DELETE);
+
+	}
+	if (result != ISC_R_SUCCESS && result != ISC_R_NOMORE)
+		log_error_r("mldap_iter_deadnodes_* failed, run rndc reload");
+}
+
 /**
  * Called when specific intermediate/final messages are returned
  * by ldap_sync_init()/ldap_sync_poll().
@@ -4460,69 +6276,62 @@ int ldap_sync_intermediate (
 	BerVarray			syncUUIDs,
 	ldap_sync_refresh_t		phase ) {
 
-	isc_result_t	result;
 	ldap_instance_t *inst = ls->ls_private;
-	metadb_iter_t *mldap_iter = NULL;
-	char entryUUID_buf[16];
-	struct berval entryUUID = { .bv_len = sizeof(entryUUID_buf),
-				    .bv_val = entryUUID_buf };
-	sync_state_t state;
+	ldap_instance_t *member;
+	ldap_sync_refresh_t uuid_phase;
+	bool sweep;
+	unsigned int i;
 
 	UNUSED(msg);
-	UNUSED(syncUUIDs);
 
 	if (inst->exiting)
 		goto cleanup;
 
 	log_debug(1, "ldap_sync_intermediate 0x%x", phase);
-	if (phase != LDAP_SYNC_CAPI_DONE)
-		goto cleanup;
-
-	sync_state_get(inst->sctx, &state);
-	if (state == sync_datainit) {
-		result = sync_barrier_wait(inst->sctx, inst);
-		if (result != ISC_R_SUCCESS) {
-			log_error_r("%s: sync_barrier_wait() failed for "
-				    "instance '%s'", __func__, inst->db_name);
-			goto cleanup;
-		}
+	if (phase == LDAP_SYNC_CAPI_PRESENTS ||
+	    phase == LDAP_SYNC_CAPI_PRESENTS_IDSET)
+		inst->sync_present = true;
+
+	/* Resumed session can list unchanged and deleted entries by UUID. */
+	if ((phase == LDAP_SYNC_CAPI_PRESENTS_IDSET ||
+	     phase == LDAP_SYNC_CAPI_DELETES_IDSET) && syncUUIDs != NULL) {
+		uuid_phase = (phase == LDAP_SYNC_CAPI_PRESENTS_IDSET)
+			     ? LDAP_SYNC_CAPI_PRESENT : LDAP_SYNC_CAPI_DELETE;
+		sync_share_lock(inst);
+		for (member = sync_share_next(inst, NULL);
+		     member != NULL;
+		     member = sync_share_next(inst, member))
+			for (i = 0; syncUUIDs[i].bv_val != NULL; i++)
+				ldap_sync_entry_process(member, NULL, NULL,
+							&syncUUIDs[i],
+							uuid_phase);
+		sync_share_unlock(inst);
 	}
 
-	for (result = mldap_iter_deadnodes_start(inst->mldapdb, &mldap_iter,
-						 &entryUUID);
-	     result == ISC_R_SUCCESS;
-	     result = mldap_iter_deadnodes_next(inst->mldapdb, &mldap_iter,
-					        &entryUUID)) {
-		ldap_sync_search_entry(ls, NULL, &entryUUID,
-				       LDAP_SYNC_CAPI_DELETE);
+	if (phase != LDAP_SYNC_CAPI_DONE)
+		goto cleanup;
 
-	}
-	if (result != ISC_R_SUCCESS && result != ISC_R_NOMORE)
-		log_error_r("mldap_iter_deadnodes_* failed, run rndc reload");
+	sweep = (inst->sync_resumed == false || inst->sync_present == true);
+	sync_share_lock(inst);
+	for (member = sync_share_next(inst, NULL);
+	     member != NULL;
+	     member = sync_share_next(inst, member))
+		ldap_sync_refresh_done(member, sweep);
+	sync_share_unlock(inst);
 
 cleanup:
 	return LDAP_SUCCESS;
 }
 
-/*
- * Called when a searchResultDone is returned
- * by ldap_sync_init()/ldap_sync_poll().
- * In refreshAndPersist, this can only occur if the search for any reason
- * is being terminated by the server.
+/**
+ * Finish configuration synchronization for one instance.
  */
-int ATTR_NONNULLS ATTR_CHECKRESULT ldap_sync_search_result (
-	ldap_sync_t			*ls,
-	LDAPMessage			*msg,
-	int				refreshDeletes ) {
+static void ATTR_NONNULLS
+ldap_sync_config_done(ldap_instance_t *inst)
+{
 	isc_result_t	result;
-	ldap_instance_t *inst = ls->ls_private;
 	sync_state_t state;
 
-	UNUSED(msg);
-	UNUSED(refreshDeletes);
-
-	log_debug(1, "ldap_sync_search_result");
-
 	if (inst->exiting)
 		goto cleanup;
 
@@ -4544,6 +6353,34 @@ int ATTR_NONNULLS ATTR_CHECKRESULT ldap_sync_search_result (
 		 inst->db_name);
 
 cleanup:
+	return;
+}
+
+/*
+ * Called when a searchResultDone is returned
+ * by ldap_sync_init()/ldap_sync_poll().
+ * In refreshAndPersist, this can only occur if the search for any reason
+ * is being terminated by the server.
+ */
+int ATTR_NONNULLS ATTR_CHECKRESULT ldap_sync_search_result (
+	ldap_sync_t			*ls,
+	LDAPMessage			*msg,
+	int				refreshDeletes ) {
+	ldap_instance_t *inst = ls->ls_private;
+	ldap_instance_t *member;
+
+	UNUSED(msg);
+	UNUSED(refreshDeletes);
+
+	log_debug(1, "ldap_sync_search_result");
+
+	sync_share_lock(inst);
+	for (member = sync_share_next(inst, NULL);
+	     member != NULL;
+	     member = sync_share_next(inst, member))
+		ldap_sync_config_done(member);
+	sync_share_unlock(inst);
+
 	return LDAP_SUCCESS;
 }
 
@@ -4576,12 +6413,22 @@ ldap_sync_prepare(ldap_instance_t *inst, settings_set_t *settings,
 	isc_result_t result;
 	const char *base = NULL;
 	ldap_sync_t *ldap_sync = NULL;
+	ldap_instance_t *member;
 
 	REQUIRE(inst != NULL);
 	REQUIRE(ldap_syncp != NULL && *ldap_syncp == NULL);
 
 	/* Remove stale zone & journal files. */
 	CHECK(cleanup_files(inst));
+	sync_share_lock(inst);
+	for (member = sync_share_next(inst, NULL);
+	     member != NULL;
+	     member = sync_share_next(inst, member)) {
+		if (member != inst && cleanup_files(member) != ISC_R_SUCCESS)
+			log_error("cannot remove stale files of instance '%s'",
+				  member->db_name);
+	}
+	sync_share_unlock(inst);
 
 	if(conn->handle == NULL)
 		CLEANUP_WITH(ISC_R_NOTCONNECTED);
@@ -4593,7 +6440,7 @@ ldap_sync_prepare(ldap_instance_t *inst, settings_set_t *settings,
 	}
 	ZERO_PTR(ldap_sync);
 
-	CHECK(setting_get_str("base", settings, &base));
+	CHECK(setting_get_str(SETTING_BASE, settings, &base));
 	ldap_sync->ls_base = ldap_strdup(base);
 	if (ldap_sync->ls_base == NULL)
 		CLEANUP_WITH(ISC_R_NOMEMORY);
@@ -4623,10 +6470,39 @@ cleanup:
 	return result;
 }
 
+/**
+ * Check if LDAP server refused to resume synchronization from the cookie
+ * (e-syncRefreshRequired) and drop the cookie so the next session does
+ * full refresh.
+ */
+static bool ATTR_NONNULLS ATTR_CHECKRESULT
+ldap_sync_refresh_required(ldap_sync_t *ldap_sync, int ret)
+{
+#ifdef LDAP_SYNC_REFRESH_REQUIRED
+	if (ret != LDAP_SYNC_REFRESH_REQUIRED)
+		return false;
+
+	log_info("LDAP server cannot resume synchronization, "
+		 "full synchronization is required");
+	if (ldap_sync->ls_cookie.bv_val != NULL)
+		ldap_memfree(ldap_sync->ls_cookie.bv_val);
+	BER_BVZERO(&ldap_sync->ls_cookie);
+	return true;
+#else
+	UNUSED(ldap_sync);
+	UNUSED(ret);
+	return false;
+#endif
+}
+
 /**
  * Start one SyncRepl session and process all events produced by it.
    LDAP_SYNC_REFRESH_AND_PERSIST mode returns only if an error occurred.
  *
+ * Session is resumed from the cookie left by the previous session in the same
+ * mode so only changes made in LDAP since then are transferred. The cookie
+ * is dropped if LDAP server asks for full refresh.
+ *
  * @post Conn is unbound and invalid. The connection needs to be re-established.
  *
  * @param[in]  conn          Valid and bound LDAP connection.
@@ -4658,9 +6534,13 @@ ldap_sync_doit(ldap_instance_t *inst, ldap_connection_t *conn,
 		"%s"
 		")";
 	const char *server_id = NULL;
+	struct berval *cookie = (mode == LDAP_SYNC_REFRESH_ONLY)
+				? &inst->sync_cookie_config
+				: &inst->sync_cookie_data;
 
 	/* request idnsServerConfig object only if server_id is specified */
-	CHECK(setting_get_str("server_id", inst->server_ldap_settings, &server_id));
+	CHECK(setting_get_str(SETTING_SERVER_ID, inst->server_ldap_settings,
+			      &server_id));
 	if (strlen(server_id) == 0) {
 		s_len = snprintf(filter, sizeof(filter),
 				 config_template, "", "", "", filter_objcs);
@@ -4687,9 +6567,20 @@ ldap_sync_doit(ldap_instance_t *inst, ldap_connection_t *conn,
 		goto cleanup;
 	}
 
+	/* The cookie is owned by ldap_sync until the session ends. */
+	ldap_sync->ls_cookie = *cookie;
+	BER_BVZERO(cookie);
+	inst->sync_resumed = (ldap_sync->ls_cookie.bv_val != NULL);
+	inst->sync_present = false;
+	if (inst->sync_resumed == true)
+		log_debug(1, "resuming LDAP synchronization from cookie");
+
 	ret = ldap_sync_init(ldap_sync, mode);
 	/* TODO: error handling, set tainted flag & do full reload? */
-	if (ret != LDAP_SUCCESS) {
+	if (ldap_sync_refresh_required(ldap_sync, ret) == true) {
+		conn->handle = NULL;
+		CLEANUP_WITH(ISC_R_NOTCONNECTED);
+	} else if (ret != LDAP_SUCCESS) {
 		if (ret == LDAP_UNAVAILABLE_CRITICAL_EXTENSION)
 			err_hint = ": is RFC 4533 supported by LDAP server?";
 		else
@@ -4700,11 +6591,25 @@ ldap_sync_doit(ldap_instance_t *inst, ldap_connection_t *conn,
 		conn->handle = NULL;
 		CLEANUP_WITH(ISC_R_NOTCONNECTED);
 	}
+	/* Refresh phase runs inside ldap_sync_init(). Publish zones created
+	 * by the refresh after reconnect, when synchronization is already
+	 * finished. */
+	sync_share_publish(inst);
 
 	while (!inst->exiting && ret == LDAP_SUCCESS
 	       && mode == LDAP_SYNC_REFRESH_AND_PERSIST) {
+		if (sync_share_resync(inst, false) == true) {
+			log_info("restarting LDAP synchronization "
+				 "for new instance");
+			break;
+		}
 		ret = ldap_sync_poll(ldap_sync);
-		if (!inst->exiting && ret != LDAP_SUCCESS) {
+		/* Publish zones created by changes received in this poll. */
+		sync_share_publish(inst);
+		if (ldap_sync_refresh_required(ldap_sync, ret) == true) {
+			conn->handle = NULL;
+		} else if (!inst->exiting && ret != LDAP_SUCCESS &&
+			   sync_share_resync(inst, false) == false) {
 			log_ldap_error(ldap_sync->ls_ld,
 				       "ldap_sync_poll() failed");
 			/* force reconnect in sync_prepare */
@@ -4713,6 +6618,10 @@ ldap_sync_doit(ldap_instance_t *inst, ldap_connection_t *conn,
 	}
 
 cleanup:
+	if (ldap_sync != NULL) {
+		*cookie = ldap_sync->ls_cookie;
+		BER_BVZERO(&ldap_sync->ls_cookie);
+	}
 	ldap_sync_cleanup(&ldap_sync);
 	return result;
 }
@@ -4730,7 +6639,10 @@ ldap_syncrepl_watcher(isc_threadarg_t arg)
 	isc_result_t result;
 	sigset_t sigset;
 	uint32_t reconnect_interval;
-	sync_state_t state;
+	unsigned int delay;
+	unsigned int retries = 0;
+	unsigned int resync_tokens = RESYNC_BURST;
+	time_t resync_refill = time(NULL);
 
 	log_debug(1, "Entering ldap_syncrepl_watcher");
 
@@ -4748,15 +6660,24 @@ ldap_syncrepl_watcher(isc_threadarg_t arg)
 	/* pthread_sigmask fails only due invalid args */
 	RUNTIME_CHECK(ret == 0);
 
-	/* Pick connection, one is reserved purely for this thread */
-	CHECK(ldap_pool_getconnection(inst->pool, &conn));
+	/* Connection outside of the pool is reserved purely for this thread */
+	conn = inst->watcher_conn;
+	LOCK(&conn->lock);
 
 	while (!inst->exiting) {
-		sync_state_get(inst->sctx, &state);
-		if (state != sync_finished) {
-			sync_state_reset(inst->sctx);
-			CHECK(sync_task_add(inst->sctx, inst->task));
+		if (sync_share_isleader(inst) == false) {
+			/* Another instance runs syncrepl session for us. */
+			if (!sane_sleep(inst, 1))
+				CLEANUP_WITH(ISC_R_SHUTTINGDOWN);
+			continue;
 		}
+		if (!resync_throttle(inst, &resync_tokens, &resync_refill))
+			CLEANUP_WITH(ISC_R_SHUTTINGDOWN);
+
+		sync_share_lock(inst);
+		result = sync_share_start(inst, false);
+		sync_share_unlock(inst);
+		CHECK(result);
 		/* synchronize configuration first so configuration variables
 		 * are already available during data processing */
 		result = ldap_sync_doit(inst, conn, "", LDAP_SYNC_REFRESH_ONLY);
@@ -4772,13 +6693,10 @@ ldap_syncrepl_watcher(isc_threadarg_t arg)
 		}
 
 		/* finally synchronize the data */
-		sync_state_get(inst->sctx, &state);
-		if (state != sync_finished)
-			CHECK(sync_task_add(inst->sctx, inst->task));
-		mldap_cur_generation_bump(inst->mldapdb);
-		log_info("LDAP data for instance '%s' are being synchronized, "
-			 "please ignore message 'all zones loaded'",
-			 inst->db_name);
+		sync_share_lock(inst);
+		result = sync_share_start(inst, true);
+		sync_share_unlock(inst);
+		CHECK(result);
 		result = ldap_sync_doit(inst, conn,
 				        "(|(objectClass=idnsZone)"
 					"  (objectClass=idnsForwardZone)"
@@ -4795,23 +6713,30 @@ retry:
 		/* Try to connect. */
 		while (conn->handle == NULL) {
 			CHECK_EXIT;
-			CHECK(setting_get_uint("reconnect_interval",
+			CHECK(setting_get_uint(SETTING_RECONNECT_INTERVAL,
 					       inst->server_ldap_settings,
 					       &reconnect_interval));
 
-			log_error("ldap_syncrepl will reconnect in %d second%s",
-				  reconnect_interval,
-				  reconnect_interval == 1 ? "": "s");
-			if (!sane_sleep(inst, reconnect_interval))
-				CLEANUP_WITH(ISC_R_SHUTTINGDOWN);
+			/* Session was interrupted by a new member of shared
+			 * session, not by a failure. */
+			if (sync_share_resync(inst, true) == false) {
+				delay = reconnect_backoff(retries++,
+							  reconnect_interval);
+				log_error("ldap_syncrepl will reconnect in "
+					  "%u second%s",
+					  delay, delay == 1 ? "": "s");
+				if (!sane_sleep(inst, delay))
+					CLEANUP_WITH(ISC_R_SHUTTINGDOWN);
+			}
 			handle_connection_error(inst, conn, true);
 		}
+		retries = 0;
 
 	}
 
 cleanup:
 	log_debug(1, "Ending ldap_syncrepl_watcher");
-	ldap_pool_putconnection(inst->pool, &conn);
+	UNLOCK(&conn->lock);
 
 	return (isc_threadresult_t)0;
 }
@@ -4840,6 +6765,12 @@ ldap_instance_getzr(ldap_instance_t *ldap_inst)
 	return ldap_inst->zone_register;
 }
 
+echo_filter_t *
+ldap_instance_getechofilter(ldap_instance_t *ldap_inst)
+{
+	return ldap_inst->echo_filter;
+}
+
 isc_task_t *
 ldap_instance_gettask(ldap_instance_t *ldap_inst)
 {
@@ -5,6 +5,7 @@
 #ifndef _LD_LDAP_HELPER_H_
 #define _LD_LDAP_HELPER_H_
 
+#include "echo_filter.h"
 #include "types.h"
 
 #include <isc/eventclass.h>
@@ -54,6 +55,9 @@ ldap_delete_zone2(ldap_instance_t *inst, dns_name_t *name, bool lock)
 isc_result_t write_to_ldap(dns_name_t *owner, dns_name_t *zone, ldap_instance_t *ldap_inst,
 		dns_rdatalist_t *rdlist) ATTR_NONNULLS;
 
+isc_result_t replace_in_ldap(dns_name_t *owner, dns_name_t *zone, ldap_instance_t *ldap_inst,
+		dns_rdatalist_t *rdlist) ATTR_NONNULLS;
+
 isc_result_t
 remove_values_from_ldap(dns_name_t *owner, dns_name_t *zone, ldap_instance_t *ldap_inst,
 		dns_rdatalist_t *rdlist, bool delete_node) ATTR_NONNULLS;
@@ -84,6 +88,8 @@ const char * ldap_instance_getdbname(ldap_instance_t *ldap_inst) ATTR_NONNULLS;
 
 zone_register_t * ldap_instance_getzr(ldap_instance_t *ldap_inst) ATTR_NONNULLS;
 
+echo_filter_t * ldap_instance_getechofilter(ldap_instance_t *ldap_inst) ATTR_NONNULLS;
+
 isc_result_t activate_zones(ldap_instance_t *inst) ATTR_NONNULLS;
 
 isc_task_t * ldap_instance_gettask(ldap_instance_t *ldap_inst);
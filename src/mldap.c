@@ -6,25 +6,23 @@
  */
 
 #include <ldap.h>
+#include <limits.h>
 #include <stddef.h>
-#include <uuid/uuid.h>
+#include <string.h>
 
 #include <inttypes.h>
-#include <isc/net.h>
+#include <isc/list.h>
+#include <isc/mem.h>
 #include <isc/refcount.h>
+#include <isc/region.h>
 #include <isc/result.h>
 #include <isc/util.h>
 #include <isc/serial.h>
 
-#include <dns/db.h>
-#include <dns/dbiterator.h>
-#include <dns/enumclass.h>
 #include <dns/name.h>
 #include <dns/types.h>
-#include <dns/update.h>
 
 #include "ldap_entry.h"
-#include "metadb.h"
 #include "mldap.h"
 #include "util.h"
 #include "dyndb-config.h"
@@ -45,33 +43,58 @@
 #define REFCOUNT_CAST(n) ((isc_refcount_t) (n))
 #endif
 
-/* name "ldap.uuid." */
-static unsigned char uuid_rootname_ndata[]
-	= { 4, 'u', 'u', 'i', 'd', 4, 'l', 'd', 'a', 'p', 0 };
-static unsigned char uuid_rootname_offsets[] = { 0, 5, 10 };
-static dns_name_t uuid_rootname =
-{
-	DNS_NAME_MAGIC,
-	uuid_rootname_ndata,
-	sizeof(uuid_rootname_ndata),
-	sizeof(uuid_rootname_offsets),
-	DNS_NAMEATTR_READONLY | DNS_NAMEATTR_ABSOLUTE,
-	uuid_rootname_offsets,
-	NULL,
-	{ (void *)-1, (void *)-1 },
-	{ NULL, NULL }
+/* RFC 4530 section 2.1 format = 16 octets is required */
+#define MLDAP_UUID_LEN		16
+#define MLDAP_SIZE_MIN		1024
+#define MLDAP_REMOVED		((mldap_entry_t *)-1)
+
+/**
+ * Entry in metaLDAP. Names are stored in wire format right after
+ * the structure: FQDN followed by zone name. Configuration objects
+ * do not have names.
+ */
+struct mldap_entry {
+	unsigned char		uuid[MLDAP_UUID_LEN];
+	uint32_t		generation;
+	ISC_LINK(mldap_entry_t)	link;	/* in fresh or stale list */
+	ldap_entryclass_t	class;
+	unsigned char		fqdn_len;
+	unsigned char		zone_len;
+	unsigned char		names[];
 };
 
+STATIC_ASSERT(DNS_NAME_MAXWIRE <= UCHAR_MAX, \
+	      "DNS name in wire format does not fit into unsigned char length");
+
+/**
+ * Open-addressing hash table with linear probing keyed by LDAP entry UUID.
+ *
+ * Deleted entries are replaced by MLDAP_REMOVED mark so slot positions
+ * do not change and deletion does not break running iteration. Marks
+ * are dropped when the table is rebuilt during insertion.
+ *
+ * Entries alive in the current generation are in the fresh list, all other
+ * entries are in the stale list. Generation bump moves all entries to
+ * the stale list so dead entries are enumerated without visiting
+ * entries which are alive.
+ *
+ * MetaLDAP is used only by the syncrepl watcher of the instance, i.e.
+ * by one thread at a time, so the table is not locked.
+ */
 struct mldapdb {
 	isc_mem_t	*mctx;
-	metadb_t	*mdb;
 	isc_refcount_t	generation;
+	unsigned int	size;	/* power of two */
+	unsigned int	used;	/* including MLDAP_REMOVED slots */
+	unsigned int	live;
+	mldap_entry_t	**slots;
+	ISC_LIST(mldap_entry_t)	fresh;
+	ISC_LIST(mldap_entry_t)	stale;
 };
 
 
 isc_result_t
 mldap_new(isc_mem_t *mctx, mldapdb_t **mldapp) {
-	isc_result_t result;
 	mldapdb_t *mldap = NULL;
 
 	REQUIRE(mldapp != NULL && *mldapp == NULL);
@@ -81,20 +104,27 @@ mldap_new(isc_mem_t *mctx, mldapdb_t **mldapp) {
 	isc_mem_attach(mctx, &mldap->mctx);
 
 	isc_refcount_init(&mldap->generation, 0);
-	CHECK(metadb_new(mctx, &mldap->mdb));
+	ISC_LIST_INIT(mldap->fresh);
+	ISC_LIST_INIT(mldap->stale);
+	mldap->size = MLDAP_SIZE_MIN;
+	mldap->slots = isc_mem_get(mctx,
+				   mldap->size * sizeof(*mldap->slots));
+	memset(mldap->slots, 0, mldap->size * sizeof(*mldap->slots));
 
 	*mldapp = mldap;
-	return result;
+	return ISC_R_SUCCESS;
+}
 
-cleanup:
-	metadb_destroy(&mldap->mdb);
-	MEM_PUT_AND_DETACH(mldap);
-	return result;
+static size_t
+mldap_entry_size(const mldap_entry_t *entry) {
+	return sizeof(*entry) + entry->fqdn_len + entry->zone_len;
 }
 
 void
 mldap_destroy(mldapdb_t **mldapp) {
 	mldapdb_t *mldap;
+	mldap_entry_t *entry;
+	unsigned int i;
 
 	REQUIRE(mldapp != NULL);
 
@@ -102,24 +132,22 @@ mldap_destroy(mldapdb_t **mldapp) {
 	if (mldap == NULL)
 		return;
 
-	metadb_destroy(&mldap->mdb);
+	for (i = 0; i < mldap->size; i++) {
+		entry = mldap->slots[i];
+		if (entry != NULL && entry != MLDAP_REMOVED)
+			isc_mem_put(mldap->mctx, entry,
+				    mldap_entry_size(entry));
+	}
+	isc_mem_put(mldap->mctx, mldap->slots,
+		    mldap->size * sizeof(*mldap->slots));
 	MEM_PUT_AND_DETACH(mldap);
 
 	*mldapp = NULL;
 }
 
-isc_result_t
-mldap_newversion(mldapdb_t *mldap) {
-	return metadb_newversion(mldap->mdb);
-}
-
-void
-mldap_closeversion(mldapdb_t *mldap, bool commit) {
-	return metadb_closeversion(mldap->mdb, commit);
-}
-
 /**
  * Atomically increment MetaLDAP generation number.
+ * All entries become dead until they are touched or created again.
  */
 void mldap_cur_generation_bump(mldapdb_t *mldap) {
 	REQUIRE(mldap != NULL);
@@ -129,6 +157,7 @@ void mldap_cur_generation_bump(mldapdb_t *mldap) {
 #else
 	isc_refcount_increment0(&mldap->generation);
 #endif
+	ISC_LIST_APPENDLIST(mldap->stale, mldap->fresh, link);
 }
 
 /*
@@ -157,399 +186,305 @@ mldap_cur_generation_get(mldapdb_t *mldap) {
 }
 
 /**
- * Convert UUID to "01234567-89ab-cdef-0123-456789abcdef.uuid.ldap." DNS name.
- *
- * @param[in]  beruuid
- * @param[out] nameuuid
+ * Hash of binary UUID. Time-based UUIDs share most of their bits
+ * so all of them have to be mixed in.
  */
-void
-ldap_uuid_to_mname(struct berval *beruuid, dns_name_t *nameuuid) {
-	/* UUID string representation according to RFC 4122 section 3 */
-	char label_buf[sizeof("01234567-89ab-cdef-0123-456789abcdef") + 1];
-	/* uncompressed label format, length 36 octets; RFC 1034 section 3.1 */
-	label_buf[0] = 36;
-
-	isc_region_t label_reg;
-	label_reg.base = (unsigned char *)label_buf;
-	label_reg.length = sizeof(label_buf) - 1; /* omit final \0 */
-
-	dns_name_t relative_name;
-	DNS_NAME_INIT(&relative_name, NULL);
-
-	/* RFC 4530 section 2.1 format = 16 octets is required */
-	REQUIRE(beruuid != NULL && beruuid->bv_len == 16);
-
-	/* fill-in string representation into label buffer */
-	uuid_unparse((*(const uuid_t *) beruuid->bv_val), label_buf + 1);
-	dns_name_fromregion(&relative_name, &label_reg);
-
-	INSIST(dns_name_concatenate(&relative_name, &uuid_rootname,
-				    nameuuid, NULL) == ISC_R_SUCCESS);
-
-	return;
+static unsigned int
+mldap_uuid_hash(const unsigned char *uuid) {
+	uint64_t a;
+	uint64_t b;
+
+	memcpy(&a, uuid, sizeof(a));
+	memcpy(&b, uuid + sizeof(a), sizeof(b));
+	a ^= b * 0x9E3779B97F4A7C15ULL;
+	a ^= a >> 29;
+	a *= 0xBF58476D1CE4E5B9ULL;
+	a ^= a >> 32;
+
+	return (unsigned int)a;
 }
 
-STATIC_ASSERT((sizeof(ldap_entryclass_t) <= sizeof(struct in6_addr)), \
-		"ldap_entryclass_t is too big for AAAA rdata type");
 /**
- * ldap_entryclass_t is stored inside AAAA record type
+ * Find slot with entry with given UUID.
+ *
+ * @returns Index of the slot or -1 if the entry does not exist.
  */
-static isc_result_t
-mldap_class_store(ldap_entryclass_t class, metadb_node_t *node) {
-	unsigned char buff[sizeof(struct in6_addr)];
-	isc_region_t region = { .base = buff, .length = sizeof(buff) };
-	dns_rdata_t rdata;
-
-	dns_rdata_init(&rdata);
-	memset(buff, 0, sizeof(buff));
-
-	/* Bytes should be in network-order but we do not care because:
-	 * 1) It is used only internally.  2) Class is unsigned char. */
-	memcpy(buff, &class, sizeof(class));
-	dns_rdata_fromregion(&rdata, dns_rdataclass_in, dns_rdatatype_aaaa,
-			     &region);
-
-	return metadb_rdata_store(&rdata, node);
+static int
+mldap_find(mldapdb_t *mldap, struct berval *uuid) {
+	unsigned int mask = mldap->size - 1;
+	unsigned int i;
+	mldap_entry_t *entry;
+
+	REQUIRE(uuid != NULL && uuid->bv_len == MLDAP_UUID_LEN);
+
+	/* Table is at most half full so the search always terminates. */
+	for (i = mldap_uuid_hash((unsigned char *)uuid->bv_val) & mask;
+	     (entry = mldap->slots[i]) != NULL;
+	     i = (i + 1) & mask) {
+		if (entry != MLDAP_REMOVED &&
+		    memcmp(entry->uuid, uuid->bv_val, MLDAP_UUID_LEN) == 0)
+			return (int)i;
+	}
+	return -1;
 }
 
-isc_result_t
-mldap_class_get(metadb_node_t *node, ldap_entryclass_t *classp) {
-	isc_result_t result;
-	dns_rdataset_t rdataset;
-	dns_rdata_t rdata;
-	isc_region_t region;
-
-	REQUIRE(classp != NULL);
+/**
+ * Store entry into an empty slot.
+ */
+static void
+mldap_insert(mldapdb_t *mldap, mldap_entry_t *entry) {
+	unsigned int mask = mldap->size - 1;
+	unsigned int i;
+
+	for (i = mldap_uuid_hash(entry->uuid) & mask;
+	     mldap->slots[i] != NULL;
+	     i = (i + 1) & mask)
+		;
+	mldap->slots[i] = entry;
+	mldap->used++;
+	mldap->live++;
+}
 
-	dns_rdata_init(&rdata);
-	dns_rdataset_init(&rdataset);
+/**
+ * Make sure that there is room for one more entry. The table is rebuilt
+ * if it is half full, removed slots are dropped.
+ */
+static void
+mldap_reserve(mldapdb_t *mldap) {
+	mldap_entry_t **old_slots = mldap->slots;
+	unsigned int old_size = mldap->size;
+	unsigned int i;
 
-	CHECK(metadb_rdataset_get(node, dns_rdatatype_aaaa, &rdataset));
-	dns_rdataset_current(&rdataset, &rdata);
-	dns_rdata_toregion(&rdata, &region);
-	/* Bytes should be in network-order but we do not care because:
-	 * 1) It is used only internally.  2) Class is unsigned char. */
-	memcpy(classp, region.base, sizeof(*classp));
+	if ((mldap->used + 1) * 2 <= mldap->size)
+		return;
 
-cleanup:
-	if (dns_rdataset_isassociated(&rdataset))
-		dns_rdataset_disassociate(&rdataset);
-	return result;
+	for (mldap->size = MLDAP_SIZE_MIN;
+	     (mldap->live + 1) * 4 > mldap->size;
+	     mldap->size *= 2)
+		;
+	mldap->slots = isc_mem_get(mldap->mctx,
+				   mldap->size * sizeof(*mldap->slots));
+	memset(mldap->slots, 0, mldap->size * sizeof(*mldap->slots));
+	mldap->used = 0;
+	mldap->live = 0;
+	for (i = 0; i < old_size; i++)
+		if (old_slots[i] != NULL && old_slots[i] != MLDAP_REMOVED)
+			mldap_insert(mldap, old_slots[i]);
+	isc_mem_put(mldap->mctx, old_slots, old_size * sizeof(*old_slots));
 }
 
 /**
- * mldapdb_t->generation is stored inside A record type
+ * Unlink entry from fresh or stale list.
  */
-static isc_result_t
-mldap_generation_store(mldapdb_t *mldap, metadb_node_t *node) {
-	isc_result_t result;
-	unsigned char buff[sizeof(mldap->generation)];
-	isc_region_t region = { .base = buff, .length = sizeof(buff) };
-	dns_rdata_t rdata;
-	uint32_t generation;
-
-	STATIC_ASSERT(sizeof(mldap_cur_generation_get(mldap)) == sizeof(struct in_addr), \
-		      "mldapdb_t->generation value is too big for A rdata type");
-	STATIC_ASSERT(sizeof(mldap_cur_generation_get(mldap)) == sizeof(generation), \
-		      "mldapdb_t->generation and local generation sizes do not match");
-
-	dns_rdata_init(&rdata);
-
-	/* Bytes should be in network-order but we do not care because:
-	 * 1) It is used only internally and always compared on this machine. */
-	generation = mldap_cur_generation_get(mldap);
-	memcpy(buff, &generation, sizeof(generation));
-	dns_rdata_fromregion(&rdata, dns_rdataclass_in, dns_rdatatype_a, &region);
-	CHECK(metadb_rdata_store(&rdata, node));
-
-cleanup:
-	return result;
+static void
+mldap_unlink(mldapdb_t *mldap, mldap_entry_t *entry) {
+	if (entry->generation == mldap_cur_generation_get(mldap))
+		ISC_LIST_UNLINK(mldap->fresh, entry, link);
+	else
+		ISC_LIST_UNLINK(mldap->stale, entry, link);
 }
 
-static isc_result_t
-mldap_generation_get(metadb_node_t *node, uint32_t *generationp) {
-	isc_result_t result;
-	dns_rdataset_t rdataset;
-	dns_rdata_t rdata;
-	isc_region_t region;
-
-	REQUIRE(generationp != NULL);
-
-	dns_rdata_init(&rdata);
-	dns_rdataset_init(&rdataset);
+static void
+mldap_remove(mldapdb_t *mldap, int slot) {
+	mldap_entry_t *entry = mldap->slots[slot];
 
-	CHECK(metadb_rdataset_get(node, dns_rdatatype_a, &rdataset));
-	dns_rdataset_current(&rdataset, &rdata);
-	dns_rdata_toregion(&rdata, &region);
-	memcpy(generationp, region.base, sizeof(*generationp));
-
-cleanup:
-	if (dns_rdataset_isassociated(&rdataset))
-		dns_rdataset_disassociate(&rdataset);
-	return result;
+	mldap_unlink(mldap, entry);
+	isc_mem_put(mldap->mctx, entry, mldap_entry_size(entry));
+	mldap->slots[slot] = MLDAP_REMOVED;
+	mldap->live--;
 }
 
 /**
- * FQDN and zone name are stored inside RP record type
+ * Store information from LDAP entry into meta-database: class and,
+ * for entries which are not configuration objects, FQDN and zone name.
+ * Existing entry with the same UUID is replaced.
+ *
+ * The entry is alive in the current generation.
  */
 isc_result_t
-mldap_dnsname_store(dns_name_t *fqdn, dns_name_t *zone, metadb_node_t *node) {
-	isc_result_t result;
-	dns_rdata_rp_t rp;
-	dns_rdata_t rdata;
-	unsigned char wirebuf[2 * DNS_NAME_MAXWIRE];
-	isc_buffer_t rdatabuf;
-
-	REQUIRE(fqdn != NULL);
-	REQUIRE(zone != NULL);
-
-	dns_rdata_init(&rdata);
-	DNS_RDATACOMMON_INIT(&rp, dns_rdatatype_rp, dns_rdataclass_in);
-	isc_buffer_init(&rdatabuf, wirebuf, sizeof(wirebuf));
-
-	/* Bytes should be in network-order but we do not care because:
-	 * 1) It is used only internally and always compared on this machine. */
-	rp.mail = *fqdn;
-	rp.text = *zone;
-	CHECK(dns_rdata_fromstruct(&rdata, dns_rdataclass_in, dns_rdatatype_rp,
-				   &rp, &rdatabuf));
-	CHECK(metadb_rdata_store(&rdata, node));
-
-cleanup:
-	return result;
+mldap_entry_create(ldap_entry_t *entry, mldapdb_t *mldap) {
+	mldap_entry_t *mentry;
+	isc_region_t fqdn = { .base = NULL, .length = 0 };
+	isc_region_t zone = { .base = NULL, .length = 0 };
+	int slot;
+
+	REQUIRE(entry->uuid != NULL && entry->uuid->bv_len == MLDAP_UUID_LEN);
+
+	if ((entry->class
+	    & (LDAP_ENTRYCLASS_CONFIG | LDAP_ENTRYCLASS_SERVERCONFIG)) == 0) {
+		dns_name_toregion(&entry->fqdn, &fqdn);
+		dns_name_toregion(&entry->zone_name, &zone);
+	}
+
+	slot = mldap_find(mldap, entry->uuid);
+	if (slot >= 0)
+		mldap_remove(mldap, slot);
+	mldap_reserve(mldap);
+
+	mentry = isc_mem_get(mldap->mctx,
+			     sizeof(*mentry) + fqdn.length + zone.length);
+	memcpy(mentry->uuid, entry->uuid->bv_val, MLDAP_UUID_LEN);
+	mentry->generation = mldap_cur_generation_get(mldap);
+	ISC_LINK_INIT(mentry, link);
+	ISC_LIST_APPEND(mldap->fresh, mentry, link);
+	mentry->class = entry->class;
+	mentry->fqdn_len = fqdn.length;
+	mentry->zone_len = zone.length;
+	if (fqdn.length > 0)
+		memcpy(mentry->names, fqdn.base, fqdn.length);
+	if (zone.length > 0)
+		memcpy(mentry->names + fqdn.length, zone.base, zone.length);
+	mldap_insert(mldap, mentry);
+
+	return ISC_R_SUCCESS;
 }
 
 /**
- * Retrieve FQDN and zone name from RP record in metaDB.
- * @param[in]  node
- * @param[out] fqdn
- * @param[out] zone
+ * Read information about LDAP entry from meta-database.
+ *
+ * @param[out] class Class of the entry.
+ * @param[out] fqdn  FQDN of the entry. It is not changed for configuration
+ *                   objects.
+ * @param[out] zone  Zone name of the entry. It is not changed
+ *                   for configuration objects.
  *
  * @pre DNS names fqdn and zone have dedicated buffer.
+ *
+ * @retval ISC_R_NOTFOUND Entry with given UUID does not exist.
  */
 isc_result_t
-mldap_dnsname_get(metadb_node_t *node, dns_name_t *fqdn, dns_name_t *zone) {
-	isc_result_t result;
-	dns_rdata_rp_t rp;
-	dns_rdataset_t rdataset;
-	dns_rdata_t rdata;
-
-	REQUIRE(fqdn != NULL);
-	REQUIRE(zone != NULL);
-
-	dns_rdataset_init(&rdataset);
-	dns_rdata_init(&rdata);
-
-	CHECK(metadb_rdataset_get(node, dns_rdatatype_rp, &rdataset));
-	dns_rdataset_current(&rdataset, &rdata);
-	CHECK(dns_rdata_tostruct(&rdata, &rp, NULL));
-	dns_name_copynf(&rp.mail, fqdn);
-	dns_name_copynf(&rp.text, zone);
-
-cleanup:
-	if (dns_rdataset_isassociated(&rdataset))
-		dns_rdataset_disassociate(&rdataset);
-	return result;
-}
-
-/**
- * Store information from LDAP entry into meta-database.
- */
-isc_result_t
-mldap_entry_create(ldap_entry_t *entry, mldapdb_t *mldap, metadb_node_t **nodep) {
-	isc_result_t result;
-	metadb_node_t *node = NULL;
-	DECLARE_BUFFERED_NAME(mname);
-
-	REQUIRE(nodep != NULL && *nodep == NULL);
-
-	INIT_BUFFERED_NAME(mname);
-
-	ldap_uuid_to_mname(entry->uuid, &mname);
-	CHECK(metadb_writenode_create(mldap->mdb, &mname, &node));
-
-	CHECK(mldap_class_store(entry->class, node));
-	CHECK(mldap_generation_store(mldap, node));
-
-	*nodep = node;
+mldap_entry_read(mldapdb_t *mldap, struct berval *uuid,
+		 ldap_entryclass_t *class, dns_name_t *fqdn, dns_name_t *zone) {
+	mldap_entry_t *mentry;
+	isc_region_t region;
+	dns_name_t name;
+	int slot;
+
+	slot = mldap_find(mldap, uuid);
+	if (slot < 0)
+		return ISC_R_NOTFOUND;
+
+	mentry = mldap->slots[slot];
+	*class = mentry->class;
+	if (mentry->fqdn_len > 0) {
+		dns_name_init(&name, NULL);
+		region.base = mentry->names;
+		region.length = mentry->fqdn_len;
+		dns_name_fromregion(&name, &region);
+		dns_name_copynf(&name, fqdn);
+
+		dns_name_init(&name, NULL);
+		region.base = mentry->names + mentry->fqdn_len;
+		region.length = mentry->zone_len;
+		dns_name_fromregion(&name, &region);
+		dns_name_copynf(&name, zone);
+	}
 
-cleanup:
-	if (result != ISC_R_SUCCESS)
-		metadb_node_close(&node);
-	return result;
+	return ISC_R_SUCCESS;
 }
 
 /**
- * Open metaLDAP entry for reading.
- * All notes about metadb_readnode_open() apply equally here.
+ * Mark existing metaLDAP entry as alive in the current generation
+ * so it is not returned by mldap_iter_deadnodes_*().
+ *
+ * @retval ISC_R_NOTFOUND Entry with given UUID does not exist.
  */
 isc_result_t
-mldap_entry_read(mldapdb_t *mldap, struct berval *uuid, metadb_node_t **nodep) {
-	DECLARE_BUFFERED_NAME(mname);
-
-	INIT_BUFFERED_NAME(mname);
-
-	ldap_uuid_to_mname(uuid, &mname);
-
-	return metadb_readnode_open(mldap->mdb, &mname, nodep);
+mldap_entry_touch(mldapdb_t *mldap, struct berval *uuid) {
+	mldap_entry_t *entry;
+	int slot;
+
+	slot = mldap_find(mldap, uuid);
+	if (slot < 0)
+		return ISC_R_NOTFOUND;
+
+	entry = mldap->slots[slot];
+	mldap_unlink(mldap, entry);
+	entry->generation = mldap_cur_generation_get(mldap);
+	ISC_LIST_APPEND(mldap->fresh, entry, link);
+	return ISC_R_SUCCESS;
 }
 
 /**
- * Delete metaLDAP entry.
- * All notes about metadb_writenode_open() apply equally here.
+ * Delete metaLDAP entry. Deletion does not break running iteration.
+ *
+ * @retval ISC_R_NOTFOUND Entry with given UUID does not exist.
  */
 isc_result_t
 mldap_entry_delete(mldapdb_t *mldap, struct berval *uuid) {
-	isc_result_t result;
-	metadb_node_t *node = NULL;
-	DECLARE_BUFFERED_NAME(mname);
-
-	INIT_BUFFERED_NAME(mname);
-
-	ldap_uuid_to_mname(uuid, &mname);
+	int slot;
 
-	CHECK(metadb_writenode_open(mldap->mdb, &mname, &node));
-	CHECK(metadb_node_delete(&node));
+	slot = mldap_find(mldap, uuid);
+	if (slot < 0)
+		return ISC_R_NOTFOUND;
 
-cleanup:
-	return result;
+	mldap_remove(mldap, slot);
+	return ISC_R_SUCCESS;
 }
 
 /**
- * Start iteration over UUID's of dead nodes stored in uuid.ldap. sub-tree
- * of metaLDAP.
+ * Start iteration over UUID's of dead entries in metaLDAP.
  *
- * Dead node is a node with generation number lower than global generation
- * number in in metaLDAP.
+ * Dead entry is an entry with generation number lower than global generation
+ * number in in metaLDAP. Only dead entries are visited.
  *
  * @param[in]  mldap
- * @param[out] iterp
+ * @param[out] iter
  * @param[out] uuid  Pre-allocated struct berval of size == 16 bytes.
- *                   LDAP entry UUID of the first dead node will be filled in.
+ *                   LDAP entry UUID of the first dead entry will be filled in.
  *
- * @retval ISC_R_SUCCESS LDAP entry UUID of the first dead node in database
- *                       is in uuid variable. Resulting iterp can be used for
+ * @retval ISC_R_SUCCESS LDAP entry UUID of the first dead entry in database
+ *                       is in uuid variable. Resulting iter can be used for
  *                       subsequent mldap_iter_deadnodes_next() calls.
- * @retval ISC_R_NOMORE  There is no dead node in metaLDAP.
- *                       Iterp and uuid are invalid.
- * @retval other         Various errors.
+ * @retval ISC_R_NOMORE  There is no dead entry in metaLDAP.
  *
- * @warning MetaLDAP generation number cannot change during iteration.
- *          This is safety check to prevent hard-to-debug inconsistencies.
+ * @warning MetaLDAP generation number cannot change during iteration
+ *          and no entries can be created or touched. Only the entry returned
+ *          last can be deleted.
  */
 isc_result_t
-mldap_iter_deadnodes_start(mldapdb_t *mldap, metadb_iter_t **iterp,
+mldap_iter_deadnodes_start(mldapdb_t *mldap, mldap_iter_t *iter,
 			   struct berval *uuid) {
-	isc_result_t result;
-	metadb_iter_t *iter = NULL;
-
-	REQUIRE(iterp != NULL && *iterp == NULL);
-
-	CHECK(metadb_iterator_create(mldap->mdb, &iter));
-	iter->state = isc_mem_get(mldap->mctx, sizeof(uint32_t));
-	result = dns_dbiterator_seek(iter->iter, &uuid_rootname);
-	if (result == ISC_R_NOTFOUND) /* metaLDAP is empty */
-		CLEANUP_WITH(ISC_R_NOMORE);
-	else if (result != ISC_R_SUCCESS)
-		goto cleanup;
+	iter->next = ISC_LIST_HEAD(mldap->stale);
 	/* store current generation value for sanity checking */
-	*(uint32_t *)iter->state = mldap_cur_generation_get(mldap);
-
-	CHECK(mldap_iter_deadnodes_next(mldap, &iter, uuid));
+	iter->generation = mldap_cur_generation_get(mldap);
 
-	*iterp = iter;
-	return result;
-
-cleanup:
-	if (iter != NULL) {
-		SAFE_MEM_PUT(mldap->mctx, iter->state, sizeof(uint32_t));
-		iter->state = NULL;
-		metadb_iterator_destroy(&iter);
-	}
-
-	return result;
+	return mldap_iter_deadnodes_next(mldap, iter, uuid);
 }
 
 /**
- * Continue iteration over UUID's of dead nodes stored in uuid.ldap. sub-tree
- * of metaLDAP.
+ * Continue iteration over UUID's of dead entries in metaLDAP.
  *
  * @param[in]     mldap
- * @param[in,out] iterp
+ * @param[in,out] iter
  * @param[out]    uuid  Pre-allocated struct berval of size == 16 bytes.
- *                      LDAP entry UUID of the next dead node will be filled in.
+ *                      LDAP entry UUID of the next dead entry will be filled in.
  *
- * @retval ISC_R_SUCCESS LDAP entry UUID of the next dead node in database
- *                       is in uuid variable. Resulting iterp can be used for
- *                       subsequent mldap_iter_deadnodes_next() calls.
- * @retval ISC_R_NOMORE  End of iteration. Iterp and uuid are no longer valid.
- * @retval other         Various errors.
+ * @retval ISC_R_SUCCESS LDAP entry UUID of the next dead entry in database
+ *                       is in uuid variable.
+ * @retval ISC_R_NOMORE  End of iteration.
  *
  * @warning MetaLDAP generation number cannot change during iteration.
  *          This is safety check to prevent hard-to-debug inconsistencies.
  */
 isc_result_t
-mldap_iter_deadnodes_next(mldapdb_t *mldap, metadb_iter_t **iterp,
-		   struct berval *uuid) {
-	isc_result_t result;
-	dns_dbnode_t *rbt_node = NULL;
-	metadb_iter_t *iter = NULL;
-	uint32_t node_generation = 0;
-	uint32_t cur_generation;
-	metadb_node_t metadb_node;
-	DECLARE_BUFFERED_NAME(name);
-	isc_region_t name_region;
-
-	REQUIRE(uuid != NULL);
-	REQUIRE(uuid->bv_len == 16 && uuid->bv_val != NULL);
-
-	INIT_BUFFERED_NAME(name);
-	iter = *iterp;
-
-	/* create fake metaDB node for use with metaDB interface */
-	metadb_node.mctx = iter->mctx;
-	metadb_node.version = iter->version;
-	metadb_node.rbtdb = iter->rbtdb;
-
-	/* skip nodes which do not belong to UUID sub-tree or are 'fresh' */
-	while (true) {
-		if (rbt_node != NULL)
-			dns_db_detachnode(iter->rbtdb, &rbt_node);
-		dns_name_reset(&name);
-
-		CHECK(dns_dbiterator_next(iter->iter));
-		CHECK(dns_dbiterator_current(iter->iter, &rbt_node, &name));
-		if (dns_name_issubdomain(&name, &uuid_rootname) == false)
-			continue;
-		metadb_node.dbnode = rbt_node;
-
-		INSIST(mldap_generation_get(&metadb_node, &node_generation)
-		       == ISC_R_SUCCESS);
-		cur_generation = mldap_cur_generation_get(mldap);
-		/* sanity check: generation number cannot change during iteration */
-		INSIST(*(uint32_t *)(*iterp)->state == cur_generation);
-
-		if (isc_serial_lt(node_generation, cur_generation))
-			break; /* this node is from previous mLDAP generation */
-	}
-	DNS_NAME_TOREGION(&name, &name_region);
-	/* parse UUID from DNS name
-	 * "$e4113e03-03b4-11e5-b478-c78116fa7f8b\004uuid\004ldap"
-	 * - first byte of any label is length
-	 * - names derived from UUID has to have constant length */
-	INSIST(name_region.length == 37 + sizeof(uuid_rootname_ndata));
-	INSIST(name_region.base[0] == 36);
-	name_region.base[37] = '\0';
-	INSIST(uuid_parse((const char *)name_region.base + 1,
-			  *(uuid_t *)(uuid->bv_val)) == 0);
-
-cleanup:
-	if (rbt_node != NULL)
-		dns_db_detachnode(iter->rbtdb, &rbt_node);
-	if (result != ISC_R_SUCCESS) {
-		SAFE_MEM_PUT(iter->mctx, iter->state, sizeof(uint32_t));
-		iter->state = NULL;
-		metadb_iterator_destroy(iterp);
-	}
-	return result;
+mldap_iter_deadnodes_next(mldapdb_t *mldap, mldap_iter_t *iter,
+			  struct berval *uuid) {
+	mldap_entry_t *entry;
+
+	REQUIRE(uuid->bv_len == MLDAP_UUID_LEN && uuid->bv_val != NULL);
+
+	/* sanity check: generation number cannot change during iteration */
+	INSIST(iter->generation == mldap_cur_generation_get(mldap));
+
+	entry = iter->next;
+	if (entry == NULL)
+		return ISC_R_NOMORE;
+
+	INSIST(isc_serial_lt(entry->generation, iter->generation));
+	/* remember next entry, the returned one is going to be deleted */
+	iter->next = ISC_LIST_NEXT(entry, link);
+	memcpy(uuid->bv_val, entry->uuid, MLDAP_UUID_LEN);
+
+	return ISC_R_SUCCESS;
 }
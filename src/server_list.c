@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2026  bind-dyndb-ldap authors; see COPYING for license
+ */
+
+#include <isc/mem.h>
+#include <isc/mutex.h>
+#include <isc/util.h>
+
+#include <string.h>
+#include <time.h>
+
+#include "dyndb-config.h"
+#include "log.h"
+#include "server_list.h"
+#include "util.h"
+
+#define SERVER_LIST_SEPARATORS	" \t\n,"
+
+/**
+ * List of LDAP servers from 'uri' setting with measured round-trip time
+ * and health of each server.
+ *
+ * The round-trip time is a smoothed bind duration. The syncrepl watcher
+ * follows the healthy server with the lowest round-trip time, while pool
+ * connections are spread over healthy servers proportionally to their
+ * round-trip time and number of connections already bound to them.
+ * Servers which failed are tried only after all healthy servers.
+ */
+typedef struct server {
+	char		*uri;
+	uint64_t	srtt_usec;	/* 0 = not measured yet */
+	unsigned int	active;		/* connections bound to the server */
+	bool		down;
+	time_t		down_since;
+} server_t;
+
+struct server_list {
+	isc_mem_t	*mctx;
+	isc_mutex_t	lock;
+	unsigned int	count;
+	server_t	servers[SERVER_LIST_MAX];
+};
+
+isc_result_t
+server_list_create(isc_mem_t *mctx, const char *uris, server_list_t **listp)
+{
+	isc_result_t result;
+	server_list_t *list = NULL;
+	const char *uri;
+	size_t len;
+
+	REQUIRE(listp != NULL && *listp == NULL);
+
+	list = isc_mem_get(mctx, sizeof(*list));
+	ZERO_PTR(list);
+	isc_mem_attach(mctx, &list->mctx);
+	/* isc_mutex_init failures are now fatal */
+	isc_mutex_init(&list->lock);
+
+	for (uri = uris + strspn(uris, SERVER_LIST_SEPARATORS);
+	     *uri != '\0';
+	     uri += len, uri += strspn(uri, SERVER_LIST_SEPARATORS)) {
+		len = strcspn(uri, SERVER_LIST_SEPARATORS);
+		if (list->count == SERVER_LIST_MAX) {
+			log_error("at most %u LDAP servers can be specified "
+				  "in 'uri'", SERVER_LIST_MAX);
+			CLEANUP_WITH(ISC_R_RANGE);
+		}
+		list->servers[list->count].uri = isc_mem_allocate(mctx,
+								  len + 1);
+		memcpy(list->servers[list->count].uri, uri, len);
+		list->servers[list->count].uri[len] = '\0';
+		list->count++;
+	}
+	if (list->count == 0) {
+		log_error("no LDAP server specified in 'uri'");
+		CLEANUP_WITH(ISC_R_UNEXPECTEDEND);
+	}
+
+	*listp = list;
+	return ISC_R_SUCCESS;
+
+cleanup:
+	server_list_destroy(&list);
+	return result;
+}
+
+void
+server_list_destroy(server_list_t **listp)
+{
+	server_list_t *list;
+	unsigned int i;
+
+	if (listp == NULL || *listp == NULL)
+		return;
+
+	list = *listp;
+
+	for (i = 0; i < list->count; i++)
+		isc_mem_free(list->mctx, list->servers[i].uri);
+	isc_mutex_destroy(&list->lock);
+	MEM_PUT_AND_DETACH(list);
+
+	*listp = NULL;
+}
+
+/**
+ * @retval true Server a should be tried before server b.
+ *
+ * @pre list->lock is locked.
+ */
+static bool ATTR_NONNULLS ATTR_CHECKRESULT
+server_precedes(const server_t *a, const server_t *b, bool watcher)
+{
+	uint64_t score_a;
+	uint64_t score_b;
+
+	if (a->down != b->down)
+		return (b->down == true);
+	/* Server which failed long ago is more likely to be back. */
+	if (a->down == true)
+		return (a->down_since < b->down_since);
+
+	score_a = a->srtt_usec;
+	score_b = b->srtt_usec;
+	if (watcher == false) {
+		score_a *= a->active + 1;
+		score_b *= b->active + 1;
+	}
+	return (score_a < score_b);
+}
+
+/**
+ * Fill 'order' with indices of servers in the order they should be tried.
+ * Healthy servers go first, servers which failed last.
+ *
+ * @param[in] watcher True if the connection is used by syncrepl watcher.
+ *                    The watcher always prefers the closest server while
+ *                    pool connections are spread over servers.
+ *
+ * @returns Number of servers stored in 'order'.
+ */
+unsigned int
+server_list_order(server_list_t *list, bool watcher,
+		  int order[SERVER_LIST_MAX])
+{
+	unsigned int i;
+	unsigned int j;
+	int server;
+
+	LOCK(&list->lock);
+	/* Insertion sort, the list is short. Stable so the order from
+	 * configuration is kept for equal servers. */
+	for (i = 0; i < list->count; i++) {
+		server = i;
+		for (j = i; j > 0 &&
+		     server_precedes(&list->servers[server],
+				     &list->servers[order[j - 1]],
+				     watcher) == true;
+		     j--)
+			order[j] = order[j - 1];
+		order[j] = server;
+	}
+	UNLOCK(&list->lock);
+
+	return list->count;
+}
+
+const char *
+server_list_uri(server_list_t *list, int server)
+{
+	REQUIRE(server >= 0 && (unsigned int)server < list->count);
+
+	/* URIs do not change during lifetime of the list. */
+	return list->servers[server].uri;
+}
+
+/**
+ * @pre list->lock is locked.
+ */
+static void ATTR_NONNULLS
+server_update_rtt(server_t *srv, uint64_t rtt_usec)
+{
+	if (srv->srtt_usec == 0)
+		srv->srtt_usec = ISC_MAX(rtt_usec, 1);
+	else
+		srv->srtt_usec = ISC_MAX((7 * srv->srtt_usec + rtt_usec) / 8,
+					 1);
+}
+
+/**
+ * Record successful bind which took rtt_usec microseconds. The connection
+ * is counted as bound to the server until server_list_release() is called.
+ */
+void
+server_list_success(server_list_t *list, int server, uint64_t rtt_usec)
+{
+	server_t *srv;
+
+	REQUIRE(server >= 0 && (unsigned int)server < list->count);
+
+	LOCK(&list->lock);
+	srv = &list->servers[server];
+	if (srv->down == true)
+		log_info("LDAP server '%s' is reachable again", srv->uri);
+	srv->down = false;
+	server_update_rtt(srv, rtt_usec);
+	srv->active++;
+	UNLOCK(&list->lock);
+}
+
+/**
+ * Record round-trip time of an operation on a connection which is already
+ * bound to the server, e.g. a health check.
+ */
+void
+server_list_rtt(server_list_t *list, int server, uint64_t rtt_usec)
+{
+	REQUIRE(server >= 0 && (unsigned int)server < list->count);
+
+	LOCK(&list->lock);
+	server_update_rtt(&list->servers[server], rtt_usec);
+	UNLOCK(&list->lock);
+}
+
+void
+server_list_failure(server_list_t *list, int server)
+{
+	server_t *srv;
+
+	REQUIRE(server >= 0 && (unsigned int)server < list->count);
+
+	LOCK(&list->lock);
+	srv = &list->servers[server];
+	if (srv->down == false) {
+		log_error("LDAP server '%s' is not reachable", srv->uri);
+		srv->down = true;
+		srv->down_since = time(NULL);
+	}
+	UNLOCK(&list->lock);
+}
+
+void
+server_list_release(server_list_t *list, int server)
+{
+	REQUIRE(server >= 0 && (unsigned int)server < list->count);
+
+	LOCK(&list->lock);
+	INSIST(list->servers[server].active > 0);
+	list->servers[server].active--;
+	UNLOCK(&list->lock);
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2026  bind-dyndb-ldap authors; see COPYING for license
+ */
+
+#ifndef _LD_SERVER_LIST_H_
+#define _LD_SERVER_LIST_H_
+
+#include <isc/mem.h>
+
+#include <stdint.h>
+
+#include "util.h"
+
+/* Maximal number of LDAP servers in 'uri' setting. */
+#define SERVER_LIST_MAX		16
+/* Connection is not bound to any server from the list. */
+#define SERVER_NONE		(-1)
+
+typedef struct server_list server_list_t;
+
+isc_result_t
+server_list_create(isc_mem_t *mctx, const char *uris,
+		   server_list_t **listp) ATTR_NONNULLS ATTR_CHECKRESULT;
+
+void
+server_list_destroy(server_list_t **listp) ATTR_NONNULLS;
+
+unsigned int
+server_list_order(server_list_t *list, bool watcher,
+		  int order[SERVER_LIST_MAX]) ATTR_NONNULLS ATTR_CHECKRESULT;
+
+const char *
+server_list_uri(server_list_t *list, int server) ATTR_NONNULLS ATTR_CHECKRESULT;
+
+void
+server_list_success(server_list_t *list, int server,
+		    uint64_t rtt_usec) ATTR_NONNULLS;
+
+void
+server_list_rtt(server_list_t *list, int server,
+		uint64_t rtt_usec) ATTR_NONNULLS;
+
+void
+server_list_failure(server_list_t *list, int server) ATTR_NONNULLS;
+
+void
+server_list_release(server_list_t *list, int server) ATTR_NONNULLS;
+
+#endif /* !_LD_SERVER_LIST_H_ */
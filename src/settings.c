@@ -13,6 +13,7 @@
 #include <dns/name.h>
 
 #include <ctype.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
@@ -41,13 +42,20 @@ static const setting_t settings_default[] = {
 	{ "default_ttl",		default_uint(86400)		}, /* Seconds */
 	{ "uri",			no_default_string		}, /* User have to set this */
 	{ "connections",		default_uint(2)			},
+	{ "connections_max",		default_uint(0)			}, /* 0 = connections */
+	{ "connections_idle_timeout",	default_uint(300)		}, /* Seconds */
+	{ "connections_check_interval",	default_uint(60)		}, /* Seconds */
 	{ "reconnect_interval",		default_uint(60)		},
+	{ "resync_interval",		default_uint(0)			}, /* Seconds */
 	{ "timeout",			default_uint(10)		},
 	{ "timeout",			default_uint(10)		},
 	{ "base",	 		no_default_string		}, /* User have to set this */
 	{ "auth_method",		default_string("none")		},
 	{ "bind_dn",			default_string("")		},
 	{ "password",			default_string("")		},
+	{ "watcher_uri",		default_string("")		},
+	{ "watcher_bind_dn",		default_string("")		},
+	{ "watcher_password",		default_string("")		},
 	{ "krb5_principal",		default_string("")		},
 	{ "sasl_mech",			default_string("GSSAPI")	},
 	{ "sasl_user",			default_string("")		},
@@ -57,8 +65,12 @@ static const setting_t settings_default[] = {
 	{ "krb5_keytab",		default_string("")		},
 	{ "fake_mname",			default_string("")		},
 	{ "ldap_hostname",		default_string("")		},
+	{ "keepalive_idle",		default_uint(0)			}, /* Seconds */
+	{ "keepalive_probes",		default_uint(0)			},
+	{ "keepalive_interval",		default_uint(0)			}, /* Seconds */
 	{ "sync_ptr",			default_boolean(false)	},
 	{ "dyn_update",			default_boolean(false)	},
+	{ "serial_flush_interval",	default_uint(0)		}, /* Seconds */
 	/* Empty string as default update_policy declares zone as 'dynamic'
 	 * for dns_zone_isdynamic() to prevent unwanted
 	 * zone_postload() calls and warnings about serial and so on.
@@ -69,11 +81,33 @@ static const setting_t settings_default[] = {
 	{ "verbose_checks",		default_boolean(false)	},
 	{ "directory",			default_string("")		},
 	{ "server_id",			default_string("")		},
+	{ "shared_sync",		default_boolean(false)	},
 	end_of_settings
 };
 
+/** Names of settings indexed by setting_id_t. */
+static const char * const setting_names[SETTING_COUNT] = {
+#define SETTING_NAME(id, name)	name,
+	SETTING_NAMES(SETTING_NAME)
+#undef SETTING_NAME
+};
+
+/**
+ * Incremented whenever a value is set or un-set in a set of settings
+ * which is parent of another set. Changes in sets without children
+ * are counted only by generation of the set itself.
+ */
+static atomic_uint_least32_t settings_parent_generation;
+
+/* Cached resolution is distance to the set which holds the value plus one
+ * in the lowest bits, remaining bits hold generation. */
+#define RESOLVED_DEPTH_BITS	3
+#define RESOLVED_DEPTH_MASK	((1U << RESOLVED_DEPTH_BITS) - 1)
+
+static pthread_once_t settings_default_once = PTHREAD_ONCE_INIT;
+
 /** Settings set for built-in defaults. */
-const settings_set_t settings_default_set = {
+settings_set_t settings_default_set = {
 	NULL,
 	"built-in defaults",
 	NULL,
@@ -81,6 +115,140 @@ const settings_set_t settings_default_set = {
 	(setting_t *) &settings_default[0]
 };
 
+/**
+ * Get name of setting with given ID.
+ */
+const char *
+setting_name(const setting_id_t id)
+{
+	REQUIRE(id < SETTING_COUNT);
+
+	return setting_names[id];
+}
+
+/**
+ * Fill index of settings in set by ID.
+ */
+static void ATTR_NONNULLS
+settings_set_index(settings_set_t *set)
+{
+	unsigned int id;
+	unsigned int position = 0;
+
+	for (setting_t *setting = set->first_setting;
+	     setting->name != NULL;
+	     setting++) {
+		/* Too many settings, use lookup by name. */
+		if (++position > UINT8_MAX)
+			return;
+		for (id = 0; id < SETTING_COUNT; id++) {
+			if (strcmp(setting->name, setting_names[id]) == 0) {
+				set->index[id] = position;
+				break;
+			}
+		}
+		if (id == SETTING_COUNT)
+			log_bug("setting '%s' in set of settings '%s' "
+				"does not have ID", setting->name, set->name);
+	}
+	set->indexed = true;
+}
+
+static void
+settings_default_index(void)
+{
+	settings_set_index(&settings_default_set);
+}
+
+/**
+ * Get setting with given ID from one set of settings.
+ *
+ * @retval NULL The set does not contain the setting.
+ */
+static setting_t * ATTR_NONNULLS ATTR_CHECKRESULT
+setting_lookup(const settings_set_t *set, const setting_id_t id)
+{
+	if (set->indexed == true)
+		return (set->index[id] == 0)
+			? NULL : &set->first_setting[set->index[id] - 1];
+
+	for (setting_t *setting = set->first_setting;
+	     setting->name != NULL;
+	     setting++) {
+		if (strcmp(setting->name, setting_names[id]) == 0)
+			return setting;
+	}
+	return NULL;
+}
+
+/**
+ * Find the setting with defined value in set of settings or its parents.
+ *
+ * The distance to the parent set which holds the value is cached in the set
+ * together with generation of the set and its parents. The cached distance
+ * is used until a value is set or un-set in the set itself or in any set
+ * which is parent of some set.
+ *
+ * @retval NULL Value is not defined in the set or any of its parents.
+ */
+static setting_t * ATTR_NONNULLS ATTR_CHECKRESULT
+setting_resolve(const settings_set_t *const start_set, const setting_id_t id)
+{
+	const settings_set_t *set;
+	setting_t *setting;
+	uint32_t tag = 0;
+	uint32_t cached;
+	unsigned int depth;
+
+	/* The generation has to be read before the walk so the cached value
+	 * is never newer than the state it was computed from. */
+	if (start_set->resolved != NULL) {
+		tag = (uint32_t)(atomic_load(&start_set->generation)
+				 + atomic_load(&settings_parent_generation))
+		      << RESOLVED_DEPTH_BITS;
+		cached = atomic_load(&start_set->resolved[id]);
+		if ((cached & RESOLVED_DEPTH_MASK) != 0 &&
+		    (cached & ~RESOLVED_DEPTH_MASK) == tag) {
+			set = start_set;
+			for (depth = (cached & RESOLVED_DEPTH_MASK) - 1;
+			     depth > 0;
+			     depth--)
+				set = set->parent_set;
+			return setting_lookup(set, id);
+		}
+	}
+
+	for (set = start_set, depth = 0;
+	     set != NULL;
+	     set = set->parent_set, depth++) {
+		setting = setting_lookup(set, id);
+		if (setting == NULL || setting->filled == false)
+			continue;
+		/* Cache is not a part of the value, it is updated even
+		 * through const pointer. */
+		if (start_set->resolved != NULL &&
+		    depth < RESOLVED_DEPTH_MASK)
+			atomic_store(&start_set->resolved[id],
+				     tag | (depth + 1));
+		return setting;
+	}
+	return NULL;
+}
+
+/**
+ * Invalidate cached resolutions which depend on values in the set.
+ */
+static void ATTR_NONNULLS
+settings_set_changed(const settings_set_t *set)
+{
+	/* Generation is not a part of the values. */
+	settings_set_t *changed = (settings_set_t *)set;
+
+	atomic_fetch_add(&changed->generation, 1);
+	if (atomic_load(&changed->has_children) == true)
+		atomic_fetch_add(&settings_parent_generation, 1);
+}
+
 /**
  * @param[in] name Setting name.
  * @param[in] set Set of settings to start search in.
@@ -150,20 +318,25 @@ setting_find(const char *name, const settings_set_t *set,
  *                          error.)
  */
 static isc_result_t ATTR_NONNULLS ATTR_CHECKRESULT
-setting_get(const char *const name, const setting_type_t type,
+setting_get(const setting_id_t id, const setting_type_t type,
 	    const settings_set_t *const set, void *target)
 {
-	isc_result_t result;
-	setting_t *setting = NULL;
+	setting_t *setting;
 
-	REQUIRE(name != NULL);
+	REQUIRE(id < SETTING_COUNT);
 	REQUIRE(target != NULL);
 
-	CHECK(setting_find(name, set, true, true, &setting));
+	setting = setting_resolve(set, id);
+	if (setting == NULL) {
+		log_bug("setting '%s' was not found in settings tree",
+			setting_names[id]);
+		return ISC_R_NOTFOUND;
+	}
 
 	if (setting->type != type) {
 		log_bug("incompatible setting data type requested "
-			"for name '%s' in set of settings '%s'", name, set->name);				\
+			"for name '%s' in set of settings '%s'",
+			setting_names[id], set->name);
 		return ISC_R_UNEXPECTED;
 	}
 
@@ -183,31 +356,27 @@ setting_get(const char *const name, const setting_type_t type,
 	}
 
 	return ISC_R_SUCCESS;
-
-cleanup:
-	log_bug("setting '%s' was not found in settings tree", name);
-	return result;
 }
 
 isc_result_t
-setting_get_uint(const char *const name, const settings_set_t *const set,
+setting_get_uint(const setting_id_t id, const settings_set_t *const set,
 		 uint32_t *target)
 {
-	return setting_get(name, ST_UNSIGNED_INTEGER, set, target);
+	return setting_get(id, ST_UNSIGNED_INTEGER, set, target);
 }
 
 isc_result_t
-setting_get_str(const char *const name, const settings_set_t *const set,
+setting_get_str(const setting_id_t id, const settings_set_t *const set,
 		const char **target)
 {
-	return setting_get(name, ST_STRING, set, target);
+	return setting_get(id, ST_STRING, set, target);
 }
 
 isc_result_t
-setting_get_bool(const char *const name, const settings_set_t *const set,
+setting_get_bool(const setting_id_t id, const settings_set_t *const set,
 		 bool *target)
 {
-	return setting_get(name, ST_BOOLEAN, set, target);
+	return setting_get(id, ST_BOOLEAN, set, target);
 }
 
 /**
@@ -306,6 +475,7 @@ set_value(isc_mem_t *mctx, const settings_set_t *set, setting_t *setting,
 		break;
 	}
 	setting->filled = 1;
+	settings_set_changed(set);
 	result = ISC_R_SUCCESS;
 
 cleanup:
@@ -390,6 +560,7 @@ setting_unset(const char *const name, const settings_set_t *set)
 		break;
 	}
 	setting->filled = 0;
+	settings_set_changed(set);
 
 cleanup:
 	UNLOCK(set->lock);
@@ -495,7 +666,10 @@ settings_set_create(isc_mem_t *mctx, const setting_t default_settings[],
 	REQUIRE(default_settings != NULL);
 	REQUIRE(default_set_length > 0);
 
-	new_set = isc_mem_allocate(mctx, default_set_length);
+	RUNTIME_CHECK(pthread_once(&settings_default_once,
+				   settings_default_index) == 0);
+
+	new_set = isc_mem_allocate(mctx, sizeof(*new_set));
 	ZERO_PTR(new_set);
 	isc_mem_attach(mctx, &new_set->mctx);
 
@@ -504,12 +678,23 @@ settings_set_create(isc_mem_t *mctx, const setting_t default_settings[],
 	isc_mutex_init(new_set->lock);
 
 	new_set->parent_set = parent_set;
+	if (parent_set != NULL) {
+		/* Changes in the parent have to invalidate cache
+		 * of the new set. */
+		atomic_store(&((settings_set_t *)parent_set)->has_children,
+			     true);
+		new_set->resolved = isc_mem_get(mctx, SETTING_COUNT
+						* sizeof(*new_set->resolved));
+		memset(new_set->resolved, 0,
+		       SETTING_COUNT * sizeof(*new_set->resolved));
+	}
 
 	new_set->first_setting = isc_mem_allocate(mctx, default_set_length);
 	memcpy(new_set->first_setting, default_settings, default_set_length);
 
 	new_set->name = isc_mem_allocate(mctx, strlen(set_name) + 1);
 	strcpy(new_set->name, set_name);
+	settings_set_index(new_set);
 
 	*target = new_set;
 	return ISC_R_SUCCESS;
@@ -543,6 +728,9 @@ settings_set_free(settings_set_t **set) {
 		}
 		if ((*set)->first_setting != NULL)
 			isc_mem_free(mctx, (*set)->first_setting);
+		if ((*set)->resolved != NULL)
+			isc_mem_put(mctx, (*set)->resolved, SETTING_COUNT
+				    * sizeof(*(*set)->resolved));
 		isc_mem_free(mctx, (*set)->name);
 		isc_mem_free(mctx, *set);
 		isc_mem_detach(&mctx);
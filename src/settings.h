@@ -7,6 +7,7 @@
 
 #include <isc/types.h>
 #include <inttypes.h>
+#include <stdatomic.h>
 
 #include <isccfg/grammar.h>
 
@@ -21,6 +22,63 @@
 
 typedef struct setting	setting_t;
 
+/*
+ * Names of all settings. Values are looked up using compile-time
+ * IDs SETTING_<NAME> so lookups do not compare strings.
+ */
+#define SETTING_NAMES(X) \
+	X(ACTIVE,			"active") \
+	X(ALLOW_QUERY,			"allow_query") \
+	X(ALLOW_TRANSFER,		"allow_transfer") \
+	X(AUTH_METHOD,			"auth_method") \
+	X(AUTH_METHOD_ENUM,		"auth_method_enum") \
+	X(BASE,				"base") \
+	X(BIND_DN,			"bind_dn") \
+	X(CONNECTIONS,			"connections") \
+	X(CONNECTIONS_CHECK_INTERVAL,	"connections_check_interval") \
+	X(CONNECTIONS_IDLE_TIMEOUT,	"connections_idle_timeout") \
+	X(CONNECTIONS_MAX,		"connections_max") \
+	X(DEFAULT_TTL,			"default_ttl") \
+	X(DIRECTORY,			"directory") \
+	X(DYN_UPDATE,			"dyn_update") \
+	X(FAKE_MNAME,			"fake_mname") \
+	X(FORWARD_POLICY,		"forward_policy") \
+	X(FORWARDERS,			"forwarders") \
+	X(KEEPALIVE_IDLE,		"keepalive_idle") \
+	X(KEEPALIVE_INTERVAL,		"keepalive_interval") \
+	X(KEEPALIVE_PROBES,		"keepalive_probes") \
+	X(KRB5_KEYTAB,			"krb5_keytab") \
+	X(KRB5_PRINCIPAL,		"krb5_principal") \
+	X(LDAP_HOSTNAME,		"ldap_hostname") \
+	X(NSEC3PARAM,			"nsec3param") \
+	X(PASSWORD,			"password") \
+	X(RECONNECT_INTERVAL,		"reconnect_interval") \
+	X(RESYNC_INTERVAL,		"resync_interval") \
+	X(SASL_AUTH_NAME,		"sasl_auth_name") \
+	X(SASL_MECH,			"sasl_mech") \
+	X(SASL_PASSWORD,		"sasl_password") \
+	X(SASL_REALM,			"sasl_realm") \
+	X(SASL_USER,			"sasl_user") \
+	X(SERIAL_FLUSH_INTERVAL,	"serial_flush_interval") \
+	X(SERVER_ID,			"server_id") \
+	X(SHARED_SYNC,			"shared_sync") \
+	X(SUBSTITUTIONVARIABLE_IPALOCATION, "substitutionvariable_ipalocation") \
+	X(SYNC_PTR,			"sync_ptr") \
+	X(TIMEOUT,			"timeout") \
+	X(UPDATE_POLICY,		"update_policy") \
+	X(URI,				"uri") \
+	X(VERBOSE_CHECKS,		"verbose_checks") \
+	X(WATCHER_BIND_DN,		"watcher_bind_dn") \
+	X(WATCHER_PASSWORD,		"watcher_password") \
+	X(WATCHER_URI,			"watcher_uri")
+
+typedef enum {
+#define SETTING_ENUM(id, name)	SETTING_##id,
+	SETTING_NAMES(SETTING_ENUM)
+#undef SETTING_ENUM
+	SETTING_COUNT
+} setting_id_t;
+
 /* Make sure that cases in get_value_ptr() are synchronized */
 typedef enum {
 	ST_STRING,
@@ -46,6 +104,21 @@ struct settings_set {
 	const settings_set_t	*parent_set;
 	isc_mutex_t		*lock;  /**< locks only values */
 	setting_t		*first_setting;
+
+	/* Positions of settings in first_setting array by ID counted from 1,
+	 * 0 if the set does not contain the setting. Used only if indexed is
+	 * true, i.e. for sets created by settings_set_create() and for
+	 * built-in defaults. */
+	bool			indexed;
+	uint8_t			index[SETTING_COUNT];
+	/* Number of changes of values in this set. */
+	atomic_uint_least32_t	generation;
+	/* The set is parent of another set. */
+	atomic_bool		has_children;
+	/* Distance to the parent set which holds value of the setting,
+	 * tagged with generation of the set and its parents. Allocated only
+	 * for sets with parent. See setting_resolve(). */
+	atomic_uint_least32_t	*resolved;
 };
 
 /*
@@ -97,16 +170,19 @@ setting_find(const char *name, const settings_set_t *set,
 	     bool recursive, bool filled_only,
 	     setting_t **found) ATTR_CHECKRESULT;
 
+const char *
+setting_name(const setting_id_t id) ATTR_CHECKRESULT;
+
 isc_result_t
-setting_get_uint(const char * const name, const settings_set_t * const set,
+setting_get_uint(const setting_id_t id, const settings_set_t * const set,
 		 uint32_t * target) ATTR_NONNULLS ATTR_CHECKRESULT;
 
 isc_result_t
-setting_get_str(const char * const name, const settings_set_t * const set,
+setting_get_str(const setting_id_t id, const settings_set_t * const set,
 		const char ** target) ATTR_NONNULLS ATTR_CHECKRESULT;
 
 isc_result_t
-setting_get_bool(const char * const name, const settings_set_t * const set,
+setting_get_bool(const setting_id_t id, const settings_set_t * const set,
 		 bool * target) ATTR_NONNULLS ATTR_CHECKRESULT;
 
 isc_result_t
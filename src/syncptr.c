@@ -7,13 +7,17 @@
 #include <sys/socket.h>
 
 #include <isc/event.h>
+#include <isc/mutex.h>
 #include <isc/netaddr.h>
+#include <isc/refcount.h>
 #include <isc/task.h>
 #include <isc/types.h>
 
 #include <dns/byaddr.h>
 #include <dns/db.h>
 #include <dns/diff.h>
+#include <dns/fixedname.h>
+#include <dns/rdatalist.h>
 #include <dns/rdatasetiter.h>
 #include <dns/zone.h>
 #include <dns/zt.h>
@@ -23,29 +27,75 @@
 #include "ldap_convert.h"
 #include "ldap_entry.h"
 #include "ldap_helper.h"
+#include "syncptr.h"
 #include "zone.h"
 #include "zone_register.h"
 
+#if LIBDNS_VERSION_MAJOR < 1600
+#define REFCOUNT_FLOOR 0
+#else
+#define REFCOUNT_FLOOR 1
+#endif
+
 #define LDAPDB_EVENT_SYNCPTR	(LDAPDB_EVENTCLASS + 4)
 
 #define SYNCPTR_PREF    "PTR record synchronization "
 #define SYNCPTR_FMTPRE  SYNCPTR_PREF "(%s) for '%s A/AAAA %s' "
 #define SYNCPTR_FMTPOST ldap_modop_str(mod_op), a_name_str, ip_str
 
+/* Number of reverse zones remembered by the prefix cache. */
+#define SYNC_PTR_CACHE_SIZE	16
+
 /*
- * Event for asynchronous PTR record synchronization.
+ * Single PTR record change requested by A/AAAA record change.
  */
-typedef struct sync_ptrev sync_ptrev_t;
-struct sync_ptrev {
-	ISC_EVENT_COMMON(sync_ptrev_t);
-	isc_mem_t *mctx;
+typedef struct sync_ptrop sync_ptrop_t;
+struct sync_ptrop {
 	char a_name_str[DNS_NAME_FORMATSIZE];
 	char ip_str[INET6_ADDRSTRLEN + 1];
 	DECLARE_BUFFERED_NAME(a_name);
 	DECLARE_BUFFERED_NAME(ptr_name);
-	dns_zone_t *ptr_zone;
 	int mod_op;
 	dns_ttl_t ttl;
+	ISC_LINK(sync_ptrop_t) link;
+};
+
+/*
+ * Event for asynchronous PTR record synchronization. One event carries all
+ * PTR record changes for one reverse zone which were requested before
+ * the zone task started to process the event.
+ */
+typedef struct sync_ptrev sync_ptrev_t;
+struct sync_ptrev {
+	ISC_EVENT_COMMON(sync_ptrev_t);
+	isc_mem_t *mctx;
+	sync_ptr_ctx_t *ctx;
+	dns_zone_t *ptr_zone;
+	ISC_LIST(sync_ptrop_t) ops;
+	ISC_LINK(sync_ptrev_t) link;
+};
+
+/*
+ * Reverse zone for all PTR names with the same parent, i.e. for all IPv4
+ * addresses from one /24 network or IPv6 addresses from one /124 network.
+ */
+typedef struct sync_ptr_cache_entry {
+	dns_fixedname_t		prefix;
+	dns_zone_t		*zone;
+	settings_set_t		*settings;
+} sync_ptr_cache_entry_t;
+
+struct sync_ptr_ctx {
+	isc_mem_t		*mctx;
+	isc_refcount_t		refs;
+	isc_mutex_t		lock;
+	zone_register_t		*zr;
+	/* Batches which were sent but not processed yet. */
+	ISC_LIST(sync_ptrev_t)	batches;
+	/* Zone register generation the cache content belongs to. */
+	unsigned int		cache_gen;
+	unsigned int		cache_next;
+	sync_ptr_cache_entry_t	cache[SYNC_PTR_CACHE_SIZE];
 };
 
 static void ATTR_NONNULLS
@@ -79,6 +129,207 @@ append_trailing_dot(char *str, unsigned int size) {
 	}
 }
 
+
+static void ATTR_NONNULLS
+sync_ptr_ctx_attach(sync_ptr_ctx_t *source, sync_ptr_ctx_t **targetp) {
+	REQUIRE(targetp != NULL && *targetp == NULL);
+
+#if LIBDNS_VERSION_MAJOR < 1600
+	isc_refcount_increment(&source->refs, NULL);
+#else
+	isc_refcount_increment(&source->refs);
+#endif
+	*targetp = source;
+}
+
+/**
+ * Release all zones held by the reverse zone cache.
+ *
+ * @pre ctx->lock is locked or ctx is not shared.
+ */
+static void ATTR_NONNULLS
+sync_ptr_cache_flush(sync_ptr_ctx_t *ctx) {
+	unsigned int i;
+
+	for (i = 0; i < SYNC_PTR_CACHE_SIZE; i++) {
+		if (ctx->cache[i].zone != NULL)
+			dns_zone_detach(&ctx->cache[i].zone);
+		ctx->cache[i].settings = NULL;
+	}
+	ctx->cache_next = 0;
+}
+
+static void ATTR_NONNULLS
+sync_ptr_ctx_detach(sync_ptr_ctx_t **ctxp) {
+	sync_ptr_ctx_t *ctx;
+	unsigned int refs;
+
+	REQUIRE(ctxp != NULL && *ctxp != NULL);
+
+	ctx = *ctxp;
+	*ctxp = NULL;
+
+#if LIBDNS_VERSION_MAJOR < 1600
+	isc_refcount_decrement(&ctx->refs, &refs);
+#else
+	refs = isc_refcount_decrement(&ctx->refs);
+#endif
+	if (refs != REFCOUNT_FLOOR)
+		return;
+
+	INSIST(EMPTY(ctx->batches));
+	sync_ptr_cache_flush(ctx);
+	isc_refcount_destroy(&ctx->refs);
+	isc_mutex_destroy(&ctx->lock);
+	MEM_PUT_AND_DETACH(ctx);
+}
+
+/**
+ * Create context for PTR record synchronization. The context holds
+ * batches of PTR changes waiting for processing and cache of reverse zones.
+ */
+isc_result_t
+sync_ptr_ctx_create(isc_mem_t *mctx, zone_register_t *zr,
+		    sync_ptr_ctx_t **ctxp) {
+	sync_ptr_ctx_t *ctx = NULL;
+	unsigned int i;
+
+	REQUIRE(ctxp != NULL && *ctxp == NULL);
+
+	ctx = isc_mem_get(mctx, sizeof(*ctx));
+	ZERO_PTR(ctx);
+	isc_mem_attach(mctx, &ctx->mctx);
+	/* isc_mutex_init failures are now fatal */
+	isc_mutex_init(&ctx->lock);
+	isc_refcount_init(&ctx->refs, 1);
+	ctx->zr = zr;
+	ctx->cache_gen = zr_get_generation(zr);
+	ISC_LIST_INIT(ctx->batches);
+	for (i = 0; i < SYNC_PTR_CACHE_SIZE; i++)
+		dns_fixedname_init(&ctx->cache[i].prefix);
+
+	*ctxp = ctx;
+	return ISC_R_SUCCESS;
+}
+
+/**
+ * Release the reverse zone cache and detach the context.
+ * Events waiting for processing keep the context alive.
+ */
+void
+sync_ptr_ctx_destroy(sync_ptr_ctx_t **ctxp) {
+	sync_ptr_ctx_t *ctx;
+
+	if (ctxp == NULL || *ctxp == NULL)
+		return;
+
+	ctx = *ctxp;
+	LOCK(&ctx->lock);
+	sync_ptr_cache_flush(ctx);
+	ctx->zr = NULL;
+	UNLOCK(&ctx->lock);
+
+	sync_ptr_ctx_detach(ctxp);
+}
+
+/**
+ * Get name of parent of the PTR record, i.e. the cache key.
+ */
+static void ATTR_NONNULLS
+sync_ptr_prefix(dns_name_t *ptr_name, dns_name_t *prefix) {
+	unsigned int labels = dns_name_countlabels(ptr_name);
+
+	REQUIRE(labels > 1);
+
+	dns_name_getlabelsequence(ptr_name, 1, labels - 1, prefix);
+}
+
+/**
+ * Look up reverse zone for PTR name in the cache. Whole cache is dropped
+ * if a zone was added to or removed from the zone register or the view
+ * since the cache was filled.
+ *
+ * Cached zone contains all names under the prefix except names which
+ * belong to more specific zones. The only more specific zone which can
+ * contain the PTR name is a zone for the PTR name itself, so the cache
+ * is bypassed if such zone exists.
+ */
+static isc_result_t ATTR_NONNULLS ATTR_CHECKRESULT
+sync_ptr_cache_find(sync_ptr_ctx_t *ctx, dns_name_t *ptr_name,
+		    settings_set_t **zsettings, dns_zone_t **zone) {
+	isc_result_t result = ISC_R_NOTFOUND;
+	dns_name_t prefix;
+	settings_set_t *ptr_zsettings = NULL;
+	unsigned int generation;
+	unsigned int i;
+
+	if (zr_get_zone_settings(ctx->zr, ptr_name, &ptr_zsettings)
+	    == ISC_R_SUCCESS)
+		return ISC_R_NOTFOUND;
+
+	dns_name_init(&prefix, NULL);
+	sync_ptr_prefix(ptr_name, &prefix);
+	generation = zr_get_generation(ctx->zr);
+
+	LOCK(&ctx->lock);
+	if (ctx->cache_gen != generation) {
+		sync_ptr_cache_flush(ctx);
+		ctx->cache_gen = generation;
+		goto unlock;
+	}
+	for (i = 0; i < SYNC_PTR_CACHE_SIZE; i++) {
+		if (ctx->cache[i].zone == NULL ||
+		    !dns_name_equal(dns_fixedname_name(&ctx->cache[i].prefix),
+				    &prefix))
+			continue;
+
+		dns_zone_attach(ctx->cache[i].zone, zone);
+		*zsettings = ctx->cache[i].settings;
+		result = ISC_R_SUCCESS;
+		break;
+	}
+
+unlock:
+	UNLOCK(&ctx->lock);
+	return result;
+}
+
+/**
+ * Remember reverse zone for all PTR names with the same parent as ptr_name.
+ *
+ * @param[in] generation Zone register generation obtained before the zone
+ *                       was looked up.
+ */
+static void ATTR_NONNULLS
+sync_ptr_cache_add(sync_ptr_ctx_t *ctx, unsigned int generation,
+		   dns_name_t *ptr_name, settings_set_t *zsettings,
+		   dns_zone_t *zone) {
+	sync_ptr_cache_entry_t *entry;
+	dns_name_t prefix;
+
+	dns_name_init(&prefix, NULL);
+	sync_ptr_prefix(ptr_name, &prefix);
+	/* Zone has to contain all names with the same prefix. This is not
+	 * the case for zones created for single PTR names. */
+	if (!dns_name_issubdomain(&prefix, dns_zone_getorigin(zone)))
+		return;
+
+	LOCK(&ctx->lock);
+	if (ctx->cache_gen != generation)
+		goto unlock;
+
+	entry = &ctx->cache[ctx->cache_next];
+	ctx->cache_next = (ctx->cache_next + 1) % SYNC_PTR_CACHE_SIZE;
+	if (entry->zone != NULL)
+		dns_zone_detach(&entry->zone);
+	dns_name_copynf(&prefix, dns_fixedname_name(&entry->prefix));
+	dns_zone_attach(zone, &entry->zone);
+	entry->settings = zsettings;
+
+unlock:
+	UNLOCK(&ctx->lock);
+}
+
 /**
  * Find a reverse zone for given IP address.
  *
@@ -95,10 +346,11 @@ append_trailing_dot(char *str, unsigned int size) {
  * @retval other	 Suitable reverse zone was not found.
  */
 static isc_result_t ATTR_NONNULLS ATTR_CHECKRESULT
-sync_ptr_find(dns_zt_t *zonetable, zone_register_t *zone_register, const int af,
+sync_ptr_find(sync_ptr_ctx_t *ctx, dns_zt_t *zonetable, const int af,
 	      const char *ip_str, dns_name_t *ptr_name,
 	      settings_set_t **zsettings, dns_zone_t **zone) {
 	isc_result_t result;
+	unsigned int generation;
 
 	REQUIRE(ip_str != NULL);
 
@@ -137,6 +389,12 @@ sync_ptr_find(dns_zt_t *zonetable, zone_register_t *zone_register, const int af,
 	 */
 	CHECK(dns_byaddr_createptrname(&isc_ip, 0, ptr_name));
 
+	/* Neighbouring addresses usually belong to the same zone. */
+	if (sync_ptr_cache_find(ctx, ptr_name, zsettings, zone)
+	    == ISC_R_SUCCESS)
+		return ISC_R_SUCCESS;
+	generation = zr_get_generation(ctx->zr);
+
 	/* Find an active zone containing owner name of the PTR record. */
 	result = dns_zt_find(zonetable, ptr_name, 0, NULL, zone);
 	if (result != ISC_R_SUCCESS && result != DNS_R_PARTIALMATCH)
@@ -145,7 +403,7 @@ sync_ptr_find(dns_zt_t *zonetable, zone_register_t *zone_register, const int af,
 	/* Get LDAP zone settings.
 	 * As a side-effect it checks that the zone is present in zone register,
 	 * i.e. the zone is managed by this LDAP instance. */
-	result = zr_get_zone_settings(zone_register, dns_zone_getorigin(*zone),
+	result = zr_get_zone_settings(ctx->zr, dns_zone_getorigin(*zone),
 				      zsettings);
 	if (result != ISC_R_SUCCESS) {
 		dns_zone_log(*zone, ISC_LOG_ERROR, SYNCPTR_PREF "refused: "
@@ -153,6 +411,7 @@ sync_ptr_find(dns_zt_t *zonetable, zone_register_t *zone_register, const int af,
 			     "is not managed by LDAP driver", ip_str);
 		CLEANUP_WITH(DNS_R_NOTAUTHORITATIVE);
 	}
+	sync_ptr_cache_add(ctx, generation, ptr_name, *zsettings, *zone);
 
 cleanup:
 	if (result != ISC_R_SUCCESS) {
@@ -164,21 +423,18 @@ cleanup:
 }
 
 /**
- * Check if PTR record's value in RBTDB == name of the modified A/AAAA record.
+ * Check if current PTR record's value == name of the modified A/AAAA record.
  * Update will be refused if the PTR name contains multiple PTR records or
- * if the value in RBTDB != expected name.
+ * if the current value != expected name.
  *
  * @param[in] a_name     Name of modified A/AAAA record.
  * @param[in] a_name_str Name of modified A/AAAA record as NUL terminated string.
  * @param[in] ptr_name   Name of PTR record generated from IP address in A/AAAA.
  * @param[in] zone       DNS zone containing the PTR record.
- * @param[in] ldapdb     LDAP DNS database from the zone.
- * @param[in] version    Database version for the LDAP DNS database.
+ * @param[in] ptr_count  Number of PTR records under ptr_name.
+ * @param[in] ptr_value  Value of the PTR record if ptr_count == 1.
  * @param[in] mod_op     LDAP_MOD_DELETE if A/AAAA record is being deleted
  *                       or LDAP_MOD_ADD if A/AAAA record is being added.
- * @param[out] rdataset  Will be set to the existing PTR RR set in the database.
- *                       RR set exists only if dns_rdataset_isassociated()
- *                       returns true.
  *
  * @retval ISC_R_IGNORE  A and PTR records match, no change is required.
  * @retval ISC_R_SUCCESS Prerequisites fulfilled, update is allowed.
@@ -209,59 +465,20 @@ cleanup:
  * 1.2.0.192.in-addr.arpa. 	PTR	mail.example.com.
  * @endcode
  */
-static isc_result_t ATTR_NONNULLS ATTR_CHECKRESULT
+static isc_result_t ATTR_NONNULL(1,2,3,4,5) ATTR_CHECKRESULT
 sync_ptr_validate(dns_name_t *a_name, const char *a_name_str, const char *ip_str,
-		  dns_name_t *ptr_name, dns_zone_t *zone, dns_db_t *ldapdb,
-		  dns_dbversion_t *version, int mod_op,
-		  dns_rdataset_t *rdataset) {
+		  dns_name_t *ptr_name, dns_zone_t *zone,
+		  unsigned int ptr_count, dns_name_t *ptr_value, int mod_op) {
 	isc_result_t result;
 
 	char ptr_name_str[DNS_NAME_FORMATSIZE + 1];
-	bool ptr_found;
-	dns_rdata_ptr_t ptr_rdata;
+	bool ptr_found = (ptr_count > 0);
 	char ptr_rdata_str[DNS_NAME_FORMATSIZE + 1];
 	bool ptr_a_equal = false; /* GCC requires initialization */
 
-	dns_dbnode_t *ptr_node = NULL;
-	dns_fixedname_t found_name;
-	dns_rdata_t rdata;
-
-	dns_fixedname_init(&found_name);
-	dns_rdata_init(&rdata);
-
-	REQUIRE(a_name_str != NULL);
-	REQUIRE(rdataset != NULL);
-
-	/* Find PTR RR in database. */
-	result = dns_db_find(ldapdb, ptr_name, version, dns_rdatatype_ptr,
-			     DNS_DBFIND_NOWILD, 0, &ptr_node,
-			     dns_fixedname_name(&found_name), rdataset, NULL);
-	switch (result) {
-		case ISC_R_SUCCESS:
-			INSIST(dns_name_equal(dns_fixedname_name(&found_name),
-					      ptr_name) == true);
-			ptr_found = true;
-			break;
-
-		case DNS_R_NXDOMAIN:
-		case DNS_R_NXRRSET:
-		case DNS_R_EMPTYNAME:
-			ptr_found = false;
-			/* PTR RR does not exist */
-			break;
-
-		default:
-			/* something unexpected happened */
-			dns_zone_log(zone, ISC_LOG_ERROR,
-				     SYNCPTR_FMTPRE "failed in dns_db_find()",
-				     SYNCPTR_FMTPOST);
-			goto cleanup;
-	}
-
-	/* Find the value of PTR entry. */
+	/* Check the current value of PTR entry. */
 	if (ptr_found == true) {
-		INSIST(dns_rdataset_count(rdataset) > 0);
-		if (dns_rdataset_count(rdataset) != 1) {
+		if (ptr_count != 1) {
 			dns_name_format(ptr_name, ptr_name_str,
 					DNS_NAME_FORMATSIZE);
 			append_trailing_dot(ptr_name_str, sizeof(ptr_name_str));
@@ -271,14 +488,12 @@ sync_ptr_validate(dns_name_t *a_name, const char *a_name_str, const char *ip_str
 				     SYNCPTR_FMTPOST, ptr_name_str);
 			CLEANUP_WITH(ISC_R_NOTIMPLEMENTED);
 		}
-		INSIST(dns_rdataset_first(rdataset) == ISC_R_SUCCESS);
-		dns_rdataset_current(rdataset, &rdata);
-		CHECK(dns_rdata_tostruct(&rdata, &ptr_rdata, NULL));
+		INSIST(ptr_value != NULL);
 
 		/* Compare PTR value with name of the A/AAAA record. */
 		if (dns_name_isabsolute(a_name) &&
-		    dns_name_isabsolute(&ptr_rdata.ptr) &&
-		    dns_name_equal(&ptr_rdata.ptr, a_name)) {
+		    dns_name_isabsolute(ptr_value) &&
+		    dns_name_equal(ptr_value, a_name)) {
 			ptr_a_equal = true;
 		} else {
 			ptr_a_equal = false;
@@ -286,7 +501,7 @@ sync_ptr_validate(dns_name_t *a_name, const char *a_name_str, const char *ip_str
 					DNS_NAME_FORMATSIZE);
 			append_trailing_dot(ptr_name_str,
 					    sizeof(ptr_name_str));
-			dns_name_format(&ptr_rdata.ptr, ptr_rdata_str,
+			dns_name_format(ptr_value, ptr_rdata_str,
 					DNS_NAME_FORMATSIZE);
 			append_trailing_dot(ptr_rdata_str,
 					    sizeof(ptr_rdata_str));
@@ -330,15 +545,14 @@ sync_ptr_validate(dns_name_t *a_name, const char *a_name_str, const char *ip_str
 	result = ISC_R_SUCCESS;
 
 cleanup:
-	if (ptr_node != NULL)
-		dns_db_detachnode(ldapdb, &ptr_node);
-
 	return result;
 }
 
+
 static void ATTR_NONNULLS
 sync_ptr_destroyev(sync_ptrev_t **eventp) {
 	sync_ptrev_t *ev = NULL;
+	sync_ptrop_t *op = NULL;
 
 	REQUIRE(eventp != NULL);
 
@@ -346,13 +560,86 @@ sync_ptr_destroyev(sync_ptrev_t **eventp) {
 	if (ev == NULL)
 		return;
 
+	while ((op = HEAD(ev->ops)) != NULL) {
+		ISC_LIST_UNLINK(ev->ops, op, link);
+		SAFE_MEM_PUT_PTR(ev->mctx, op);
+	}
 	if (ev->ptr_zone != NULL)
 		dns_zone_detach(&ev->ptr_zone);
+	if (ev->ctx != NULL)
+		sync_ptr_ctx_detach(&ev->ctx);
 	if (ev->mctx != NULL)
 		isc_mem_detach(&ev->mctx);
 	isc_event_free((isc_event_t **)eventp);
 }
 
+/**
+ * Append PTR record change to the batch for given reverse zone.
+ * New batch event is sent to the task associated with the zone only if
+ * there is no batch waiting for processing, so all changes requested before
+ * the zone task gets to the event are processed at once.
+ *
+ * Changes for the same PTR name are kept next to each other in the order
+ * they were requested so sync_ptr_handler() can merge them.
+ *
+ * @param[in,out] opp Operation is owned by the batch after the call and
+ *                    *opp is set to NULL.
+ */
+static void ATTR_NONNULLS
+sync_ptr_enqueue(sync_ptr_ctx_t *ctx, dns_zone_t *ptr_zone,
+		 sync_ptrop_t **opp) {
+	sync_ptrev_t *ev = NULL;
+	sync_ptrop_t *op = *opp;
+	sync_ptrop_t *queued = NULL;
+	sync_ptrop_t *last = NULL;
+	isc_task_t *task = NULL;
+
+	LOCK(&ctx->lock);
+	for (ev = HEAD(ctx->batches); ev != NULL; ev = NEXT(ev, link)) {
+		if (ev->ptr_zone == ptr_zone)
+			break;
+	}
+
+	if (ev != NULL) {
+		for (queued = HEAD(ev->ops);
+		     queued != NULL;
+		     queued = NEXT(queued, link)) {
+			if (dns_name_equal(&queued->ptr_name, &op->ptr_name))
+				last = queued;
+		}
+		if (last != NULL)
+			ISC_LIST_INSERTAFTER(ev->ops, last, op, link);
+		else
+			ISC_LIST_APPEND(ev->ops, op, link);
+		*opp = NULL;
+		goto unlock;
+	}
+
+	ev = (sync_ptrev_t *)isc_event_allocate(ctx->mctx, NULL,
+						LDAPDB_EVENT_SYNCPTR,
+						sync_ptr_handler, NULL,
+						sizeof(sync_ptrev_t));
+	ev->mctx = NULL;
+	isc_mem_attach(ctx->mctx, &ev->mctx);
+	ev->ctx = NULL;
+	sync_ptr_ctx_attach(ctx, &ev->ctx);
+	ev->ptr_zone = NULL;
+	dns_zone_attach(ptr_zone, &ev->ptr_zone);
+	ISC_LIST_INIT(ev->ops);
+	ISC_LINK_INIT(ev, link);
+
+	ISC_LIST_APPEND(ev->ops, op, link);
+	*opp = NULL;
+	ISC_LIST_APPEND(ctx->batches, ev, link);
+
+	/* Run PTR record update asynchronously. */
+	dns_zone_gettask(ptr_zone, &task);
+	isc_task_sendanddetach(&task, (isc_event_t **)&ev);
+
+unlock:
+	UNLOCK(&ctx->lock);
+}
+
 /**
  * Start PTR record synchronization. Actual synchronization will be done
  * by sync_ptr_handler() in the context of task associated with
@@ -367,43 +654,39 @@ sync_ptr_destroyev(sync_ptrev_t **eventp) {
  * @param[in]  mod_op  LDAP_MOD_DELETE if A/AAAA record is being deleted
  *                     or LDAP_MOD_ADD if A/AAAA record is being added.
  *
- * @retval ISC_R_SUCCESS Synchronization event was created and sent
- *                       to affected reverse zone.
+ * @retval ISC_R_SUCCESS Synchronization was queued for affected
+ *                       reverse zone.
  *                       Synchronization may fail later in sync_ptr_handler()
  *                       call but caller will not see this error.
  * @retval other	 Synchronization failed - reverse zone doesn't exist,
  * 			 is not active, or is not managed by this LDAP instance.
  */
 isc_result_t ATTR_NONNULLS ATTR_CHECKRESULT
-sync_ptr_init(isc_mem_t *mctx, dns_zt_t * zonetable,
-	      zone_register_t *zone_register, dns_name_t *a_name, const int af,
-	      const char *ip_str, dns_ttl_t ttl, const int mod_op) {
+sync_ptr_init(sync_ptr_ctx_t *ctx, dns_zt_t * zonetable,
+	      dns_name_t *a_name, const int af, const char *ip_str,
+	      dns_ttl_t ttl, const int mod_op) {
 	isc_result_t result;
 
 	settings_set_t *zone_settings = NULL;
 	bool zone_dyn_update;
 	char *a_name_str = NULL;
 
-	sync_ptrev_t *ev = NULL;
-	isc_task_t *task = NULL;
+	sync_ptrop_t *op = NULL;
+	dns_zone_t *ptr_zone = NULL;
 
 	REQUIRE(mod_op == LDAP_MOD_DELETE || mod_op == LDAP_MOD_ADD);
-
-	ev = (sync_ptrev_t *)isc_event_allocate(mctx, NULL,
-						LDAPDB_EVENT_SYNCPTR,
-						sync_ptr_handler, NULL,
-						sizeof(sync_ptrev_t));
-
-	ev->mctx = NULL;
-	isc_mem_attach(mctx, &ev->mctx);
-	INIT_BUFFERED_NAME(ev->a_name);
-	INIT_BUFFERED_NAME(ev->ptr_name);
-	dns_name_copynf(a_name, &ev->a_name);
-	ev->mod_op = mod_op;
-	strncpy(ev->ip_str, ip_str, sizeof(ev->ip_str));
-	ev->ip_str[sizeof(ev->ip_str) - 1] = '\0';
-	ev->ptr_zone = NULL;
-	ev->ttl = ttl;
+	REQUIRE(ctx->zr != NULL);
+
+	op = isc_mem_get(ctx->mctx, sizeof(*op));
+	ZERO_PTR(op);
+	INIT_BUFFERED_NAME(op->a_name);
+	INIT_BUFFERED_NAME(op->ptr_name);
+	ISC_LINK_INIT(op, link);
+	dns_name_copynf(a_name, &op->a_name);
+	op->mod_op = mod_op;
+	strncpy(op->ip_str, ip_str, sizeof(op->ip_str));
+	op->ip_str[sizeof(op->ip_str) - 1] = '\0';
+	op->ttl = ttl;
 
 	/**
 	 * Get string representation of PTR record value.
@@ -411,109 +694,268 @@ sync_ptr_init(isc_mem_t *mctx, dns_zt_t * zonetable,
 	 * a_name_str = "host.example.com."
 	 * @endcode
 	 */
-	dns_name_format(a_name, ev->a_name_str, sizeof(ev->a_name_str));
-	append_trailing_dot(ev->a_name_str, sizeof(ev->a_name_str));
-	a_name_str = ev->a_name_str;
+	dns_name_format(a_name, op->a_name_str, sizeof(op->a_name_str));
+	append_trailing_dot(op->a_name_str, sizeof(op->a_name_str));
+	a_name_str = op->a_name_str;
 
-	result = sync_ptr_find(zonetable, zone_register, af, ip_str,
-			       &ev->ptr_name, &zone_settings, &ev->ptr_zone);
+	result = sync_ptr_find(ctx, zonetable, af, ip_str, &op->ptr_name,
+			       &zone_settings, &ptr_zone);
 	if (result != ISC_R_SUCCESS) {
 		log_error_r(SYNCPTR_FMTPRE "refused: unable to find "
 			    "active reverse zone", SYNCPTR_FMTPOST);
 		goto cleanup;
 	}
 
-	CHECK(setting_get_bool("dyn_update", zone_settings, &zone_dyn_update));
+	CHECK(setting_get_bool(SETTING_DYN_UPDATE, zone_settings,
+			       &zone_dyn_update));
 	if (!zone_dyn_update) {
-		dns_zone_log(ev->ptr_zone, ISC_LOG_ERROR,
+		dns_zone_log(ptr_zone, ISC_LOG_ERROR,
 			     SYNCPTR_FMTPRE "refused: dynamic updates are not "
 			     "allowed for the reverse zone", SYNCPTR_FMTPOST);
 		CLEANUP_WITH(ISC_R_NOPERM);
 	}
 
-	/* Run PTR record update asynchronously. */
-	dns_zone_gettask(ev->ptr_zone, &task);
-	isc_task_sendanddetach(&task, (isc_event_t **)&ev);
+	sync_ptr_enqueue(ctx, ptr_zone, &op);
 
 cleanup:
-	sync_ptr_destroyev(&ev);
+	if (ptr_zone != NULL)
+		dns_zone_detach(&ptr_zone);
+	if (op != NULL)
+		SAFE_MEM_PUT_PTR(ctx->mctx, op);
 	return result;
 }
 
 /**
- * Update PTR record to match A/AAAA record. This function is running
- * in context of the task associated with affected reverse zone.
+ * Update PTR record to match A/AAAA records within given database version.
+ * Operations from 'first' up to 'end' change the same PTR name. Each of them
+ * is validated against the PTR value left by the preceding ones and only
+ * the final value is written to the database, so the PTR name is modified
+ * in LDAP at most once. All changes are appended to 'diff' so they can be
+ * written to the journal as one transaction.
  *
- * @retval ISC_R_SUCCESS PTR record matches A/AAAA record.
- * @retval other	 Synchronization failed: Old value in PTR record
- *                       doesn't match A/AAAA node name, etc.
+ * @retval ISC_R_SUCCESS PTR record matches A/AAAA records or the changes were
+ *                       refused. Refusals were logged by sync_ptr_validate()
+ *                       and do not affect other changes in the batch.
+ * @retval other	 Database update failed, the whole batch has
+ *                       to be rolled back.
  */
-static void ATTR_NONNULLS
-sync_ptr_handler(isc_task_t *task, isc_event_t *event) {
-	sync_ptrev_t *ev = (sync_ptrev_t *)event;
+static isc_result_t ATTR_NONNULL(1,2,3,4,5,7) ATTR_CHECKRESULT
+sync_ptr_apply(isc_mem_t *mctx, dns_zone_t *ptr_zone, dns_db_t *ldapdb,
+	       dns_dbversion_t *version, sync_ptrop_t *first,
+	       sync_ptrop_t *end, dns_diff_t *diff) {
 	isc_result_t result;
-	dns_db_t *ldapdb = NULL;
-	dns_dbversion_t *version = NULL;
+	sync_ptrop_t *op = NULL;
+	dns_name_t *ptr_name = &first->ptr_name;
 
+	dns_dbnode_t *ptr_node = NULL;
+	dns_fixedname_t found_name;
 	dns_rdataset_t old_rdataset;
+	dns_rdata_t old_rdata;
+	dns_rdata_ptr_t old_ptr_rdata;
+	unsigned int old_count = 0;
+	dns_name_t *old_value = NULL;
+
+	unsigned int ptr_count;
+	dns_name_t *ptr_value;
+	dns_ttl_t ttl = 0;
+	bool changed = false;
+
 	dns_rdata_ptr_t new_ptr_rdata;
 	unsigned char new_buf[DNS_NAME_MAXWIRE];
 	isc_buffer_t new_rdatabuf;
 	dns_rdata_t new_rdata;
+	dns_rdatalist_t new_rdlist;
+	dns_rdataset_t new_rdataset;
 
-	dns_diff_t diff;
+	dns_diff_t op_diff;
 	dns_difftuple_t *difftp = NULL;
 
-	UNUSED(task);
-
+	dns_fixedname_init(&found_name);
 	dns_rdataset_init(&old_rdataset);
-
+	dns_rdata_init(&old_rdata);
 	DNS_RDATACOMMON_INIT(&new_ptr_rdata, dns_rdatatype_ptr, dns_rdataclass_in);
 	isc_buffer_init(&new_rdatabuf, new_buf, sizeof(new_buf));
 	dns_rdata_init(&new_rdata);
-	dns_diff_init(ev->mctx, &diff);
+	dns_rdataset_init(&new_rdataset);
+	dns_diff_init(mctx, &op_diff);
 
-	CHECK(dns_zone_getdb(ev->ptr_zone, &ldapdb));
-	CHECK(dns_db_newversion(ldapdb, &version));
-	result = sync_ptr_validate(&ev->a_name, ev->a_name_str, ev->ip_str,
-				   &ev->ptr_name, ev->ptr_zone, ldapdb, version,
-				   ev->mod_op, &old_rdataset);
-	if (result == ISC_R_IGNORE)
+	/* Find PTR RR in database. */
+	result = dns_db_find(ldapdb, ptr_name, version, dns_rdatatype_ptr,
+			     DNS_DBFIND_NOWILD, 0, &ptr_node,
+			     dns_fixedname_name(&found_name), &old_rdataset,
+			     NULL);
+	switch (result) {
+		case ISC_R_SUCCESS:
+			INSIST(dns_name_equal(dns_fixedname_name(&found_name),
+					      ptr_name) == true);
+			old_count = dns_rdataset_count(&old_rdataset);
+			INSIST(old_count > 0);
+			if (old_count == 1) {
+				INSIST(dns_rdataset_first(&old_rdataset)
+				       == ISC_R_SUCCESS);
+				dns_rdataset_current(&old_rdataset, &old_rdata);
+				CHECK(dns_rdata_tostruct(&old_rdata,
+							 &old_ptr_rdata, NULL));
+				old_value = &old_ptr_rdata.ptr;
+			}
+			break;
+
+		case DNS_R_NXDOMAIN:
+		case DNS_R_NXRRSET:
+		case DNS_R_EMPTYNAME:
+			/* PTR RR does not exist */
+			break;
+
+		default:
+			/* something unexpected happened */
+			dns_zone_log(ptr_zone, ISC_LOG_ERROR,
+				     SYNCPTR_PREF "for '%s' failed in "
+				     "dns_db_find(): %s", first->ip_str,
+				     dns_result_totext(result));
+			goto cleanup;
+	}
+
+	/* Refused changes were logged already, continue with the next one. */
+	ptr_count = old_count;
+	ptr_value = old_value;
+	for (op = first; op != end; op = NEXT(op, link)) {
+		if (sync_ptr_validate(&op->a_name, op->a_name_str, op->ip_str,
+				      &op->ptr_name, ptr_zone, ptr_count,
+				      ptr_value, op->mod_op) != ISC_R_SUCCESS)
+			continue;
+		changed = true;
+		if (op->mod_op == LDAP_MOD_ADD) {
+			ptr_count = 1;
+			ptr_value = &op->a_name;
+			ttl = op->ttl;
+		} else {
+			ptr_count = 0;
+			ptr_value = NULL;
+		}
+	}
+	/* E.g. deletion followed by addition of the same value. */
+	if (changed == false || (ptr_count == 0 && old_count == 0) ||
+	    (ptr_count == 1 && old_count == 1 && ttl == old_rdataset.ttl &&
+	     dns_name_equal(ptr_value, old_value)))
 		CLEANUP_WITH(ISC_R_SUCCESS);
-	else if (result != ISC_R_SUCCESS)
-		goto cleanup;
 
 	/* Delete old PTR record if it exists in RBTDB. */
-	if (dns_rdataset_isassociated(&old_rdataset))
-		CHECK(rdataset_to_diff(ev->mctx, DNS_DIFFOP_DEL,
-				       &ev->ptr_name,
-				       &old_rdataset, &diff));
-
-	if (ev->mod_op == LDAP_MOD_ADD) {
-		new_ptr_rdata.ptr = ev->a_name;
+	if (old_count > 0)
+		CHECK(rdataset_to_diff(mctx, DNS_DIFFOP_DEL, ptr_name,
+				       &old_rdataset, &op_diff));
+
+	if (ptr_count == 0) {
+		CHECK(dns_diff_apply(&op_diff, ldapdb, version));
+	} else {
+		new_ptr_rdata.ptr = *ptr_value;
 		CHECK(dns_rdata_fromstruct(&new_rdata, dns_rdataclass_in,
 					   dns_rdatatype_ptr, &new_ptr_rdata,
 					   &new_rdatabuf));
-		CHECK(dns_difftuple_create(ev->mctx, DNS_DIFFOP_ADD,
-					   &ev->ptr_name,
-					   ev->ttl, &new_rdata, &difftp));
-		dns_diff_appendminimal(&diff, &difftp);
-	}
+		CHECK(dns_difftuple_create(mctx, DNS_DIFFOP_ADD, ptr_name,
+					   ttl, &new_rdata, &difftp));
+		dns_diff_appendminimal(&op_diff, &difftp);
 
-	if (!EMPTY(diff.tuples)) {
-		CHECK(zone_soaserial_addtuple(ev->mctx, ldapdb, version, &diff,
-		      NULL));
-		CHECK(zone_journal_adddiff(ev->mctx, ev->ptr_zone, &diff));
+		if (old_count == 0) {
+			CHECK(dns_diff_apply(&op_diff, ldapdb, version));
+		} else {
+			/* Adding without merge replaces the old value
+			 * with a single LDAP modify. */
+			dns_rdatalist_init(&new_rdlist);
+			new_rdlist.rdclass = dns_rdataclass_in;
+			new_rdlist.type = dns_rdatatype_ptr;
+			new_rdlist.ttl = ttl;
+			ISC_LIST_APPEND(new_rdlist.rdata, &new_rdata, link);
+			RUNTIME_CHECK(dns_rdatalist_tordataset(&new_rdlist,
+							       &new_rdataset)
+				      == ISC_R_SUCCESS);
+			CHECK(dns_db_addrdataset(ldapdb, ptr_node, version, 0,
+						 &new_rdataset, 0, NULL));
+		}
 	}
 
-	CHECK(dns_diff_apply(&diff, ldapdb, version));
-	dns_db_closeversion(ldapdb, &version, true);
+	while ((difftp = HEAD(op_diff.tuples)) != NULL) {
+		ISC_LIST_UNLINK(op_diff.tuples, difftp, link);
+		dns_diff_appendminimal(diff, &difftp);
+	}
 
 cleanup:
+	if (dns_rdataset_isassociated(&new_rdataset))
+		dns_rdataset_disassociate(&new_rdataset);
 	if (dns_rdataset_isassociated(&old_rdataset))
 		dns_rdataset_disassociate(&old_rdataset);
+	if (ptr_node != NULL)
+		dns_db_detachnode(ldapdb, &ptr_node);
 	if (difftp != NULL)
 		dns_difftuple_free(&difftp);
+	dns_diff_clear(&op_diff);
+
+	return result;
+}
+
+/**
+ * Update PTR records to match A/AAAA records. This function is running
+ * in context of the task associated with affected reverse zone.
+ *
+ * All changes from the batch are done in a single database version
+ * with a single SOA serial increment and a single journal transaction.
+ * Changes of the same PTR name are merged by sync_ptr_apply().
+ * Failure to apply any of them rolls back the whole batch.
+ */
+static void ATTR_NONNULLS
+sync_ptr_handler(isc_task_t *task, isc_event_t *event) {
+	sync_ptrev_t *ev = (sync_ptrev_t *)event;
+	isc_result_t result;
+	dns_db_t *ldapdb = NULL;
+	dns_dbversion_t *version = NULL;
+	sync_ptrop_t *op = NULL;
+	sync_ptrop_t *next = NULL;
+
+	dns_diff_t diff;
+	dns_diff_t soa_diff;
+	dns_difftuple_t *difftp = NULL;
+
+	UNUSED(task);
+
+	/* No more changes can be appended to this batch. */
+	LOCK(&ev->ctx->lock);
+	ISC_LIST_UNLINK(ev->ctx->batches, ev, link);
+	UNLOCK(&ev->ctx->lock);
+
+	dns_diff_init(ev->mctx, &diff);
+	dns_diff_init(ev->mctx, &soa_diff);
+
+	CHECK(dns_zone_getdb(ev->ptr_zone, &ldapdb));
+	CHECK(dns_db_newversion(ldapdb, &version));
+	for (op = HEAD(ev->ops); op != NULL; op = next) {
+		/* sync_ptr_enqueue() keeps changes of one PTR name together */
+		for (next = NEXT(op, link);
+		     next != NULL && dns_name_equal(&next->ptr_name,
+						    &op->ptr_name);
+		     next = NEXT(next, link))
+			;
+		CHECK(sync_ptr_apply(ev->mctx, ev->ptr_zone, ldapdb, version,
+				     op, next, &diff));
+	}
+
+	if (!EMPTY(diff.tuples)) {
+		CHECK(zone_soaserial_addtuple(ev->mctx, ldapdb, version,
+					      &soa_diff, NULL));
+		CHECK(dns_diff_apply(&soa_diff, ldapdb, version));
+		while ((difftp = HEAD(soa_diff.tuples)) != NULL) {
+			ISC_LIST_UNLINK(soa_diff.tuples, difftp, link);
+			dns_diff_append(&diff, &difftp);
+		}
+		CHECK(zone_journal_adddiff(ev->mctx, ev->ptr_zone, &diff));
+	}
+
+	dns_db_closeversion(ldapdb, &version, true);
+
+cleanup:
+	if (result != ISC_R_SUCCESS)
+		dns_zone_log(ev->ptr_zone, ISC_LOG_ERROR,
+			     SYNCPTR_PREF "failed, all changes in the batch "
+			     "were rolled back: %s", dns_result_totext(result));
+	dns_diff_clear(&soa_diff);
 	dns_diff_clear(&diff);
 	if (ldapdb != NULL) {
 		/* rollback if something bad happened */
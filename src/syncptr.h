@@ -6,10 +6,20 @@
 #define SRC_SYNCPTR_H_
 
 #include "util.h"
+#include "zone_register.h"
+
+typedef struct sync_ptr_ctx sync_ptr_ctx_t;
+
+isc_result_t
+sync_ptr_ctx_create(isc_mem_t *mctx, zone_register_t *zr,
+		    sync_ptr_ctx_t **ctxp) ATTR_NONNULLS ATTR_CHECKRESULT;
+
+void
+sync_ptr_ctx_destroy(sync_ptr_ctx_t **ctxp) ATTR_NONNULLS;
 
 isc_result_t ATTR_NONNULLS ATTR_CHECKRESULT
-sync_ptr_init(isc_mem_t *mctx, dns_zt_t * zonetable,
-	      zone_register_t *zone_register, dns_name_t *a_name, const int af,
-	      const char *ip_str, dns_ttl_t ttl, const int mod_op);
+sync_ptr_init(sync_ptr_ctx_t *ctx, dns_zt_t * zonetable,
+	      dns_name_t *a_name, const int af, const char *ip_str,
+	      dns_ttl_t ttl, const int mod_op);
 
 #endif /* SRC_SYNCPTR_H_ */
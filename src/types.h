@@ -37,6 +37,7 @@ typedef struct zone_register	zone_register_t;
 typedef struct mldapdb		mldapdb_t;
 typedef struct ldap_entry	ldap_entry_t;
 typedef struct settings_set	settings_set_t;
+typedef struct zone_handle	zone_handle_t;
 
 
 #define LDAPDB_EVENT_SYNCREPL_UPDATE	(LDAPDB_EVENTCLASS + 1)
@@ -48,6 +49,8 @@ struct ldap_syncreplevent {
 	char *prevdn;
 	int chgtype;
 	ldap_entry_t *entry;
+	/* Zone of the record, NULL for other events. */
+	zone_handle_t *zone;
 	uint32_t seqid;
 };
 
@@ -5,10 +5,13 @@
 #ifndef _LD_UTIL_H_
 #define _LD_UTIL_H_
 
+#include <ctype.h>
 #include <string.h>
 
 #include <isc/mem.h>
 #include <isc/buffer.h>
+#include <isc/random.h>
+#include <isc/region.h>
 #include <isc/result.h>
 #include <dns/types.h>
 #include <dns/name.h>
@@ -30,6 +33,43 @@ extern bool verbose_checks; /* from settings.c */
 #define dns_name_copynf(src, dst) dns_name_copy((src), (dst))
 #endif
 
+/**
+ * Random number from range [0, upper).
+ * isc_random_uniform() is not available in BIND 9.11.
+ */
+static inline uint32_t
+random_uniform(uint32_t upper)
+{
+#if LIBDNS_VERSION_MAJOR < 1600
+	uint32_t value;
+
+	isc_random_get(&value);
+	return (upper > 0) ? value % upper : 0;
+#else
+	return isc_random_uniform(upper);
+#endif
+}
+
+/**
+ * Case-insensitive FNV-1a hash of name in wire format.
+ * Used by hash tables keyed by DNS names.
+ */
+static inline unsigned int
+name_hash(const dns_name_t *name)
+{
+	isc_region_t r;
+	unsigned int hashval = 2166136261U;
+	unsigned int i;
+
+	dns_name_toregion(name, &r);
+	for (i = 0; i < r.length; i++) {
+		hashval ^= (unsigned int)tolower(r.base[i]);
+		hashval *= 16777619U;
+	}
+
+	return hashval;
+}
+
 #ifdef DNS_DB_STALEOK
 #define DNS_DB_ALLRDATASETS_OPTIONS(options, tstamp) options, tstamp
 #else
@@ -3,16 +3,22 @@
  */
 
 #include <isc/mem.h>
+#include <isc/refcount.h>
 #include <isc/rwlock.h>
+#include <isc/task.h>
 #include <isc/util.h>
 #include <isc/string.h>
 
+#include <sched.h>
+#include <stdatomic.h>
+
 #include <dns/db.h>
 #include <dns/rbt.h>
 #include <dns/result.h>
 #include <dns/zone.h>
 
 #include "dyndb-config.h"
+#include "dn_cache.h"
 #include "fs.h"
 #include "ldap_driver.h"
 #include "log.h"
@@ -22,6 +28,12 @@
 #include "settings.h"
 #include "rbt_helper.h"
 
+#if LIBDNS_VERSION_MAJOR < 1600
+#define REFCOUNT_FLOOR 0
+#else
+#define REFCOUNT_FLOOR 1
+#endif
+
 /**
  * The zone register is a red-black tree that maps a dns name of a zone to the
  * zone's pointer and it's LDAP DN. Synchronization is done by the zr_*
@@ -34,26 +46,58 @@
  * (idnsZoneActive = FALSE). Iterators return all zones including disabled ones.
  * Disabled zones are identified by "active" boolean = FALSE in settings_set_t
  * of the particular zone.
+ *
+ * Lookups by exact zone origin do not use the RBT nor the lock. They search
+ * a hash table which is modified only by writers holding the write lock:
+ * - new zones are published into empty slots,
+ * - removed zones are replaced by ZR_REMOVED mark and slots are never reused,
+ * - a full table is replaced by a new one.
+ * Readers announce themselves in their reader slot, see zr_read_begin().
+ * Writers wait until all readers which could see removed zone or replaced
+ * table leave before they release the zone handle or free the table,
+ * see zr_synchronize().
  */
 
+/* Number of reader slots, threads above this number share slots. */
+#define ZR_READERS	64
+#define ZR_TABLE_MIN	64
+#define ZR_REMOVED	((zone_handle_t *)-1)
+
+typedef struct {
+	/* Number of readers in critical section started in given phase. */
+	atomic_uint_fast32_t	active[2];
+	/* Each slot has its own cache line. */
+	char			pad[64 - 2 * sizeof(atomic_uint_fast32_t)];
+} zr_reader_t;
+
+typedef struct {
+	unsigned int		hash;
+	_Atomic(zone_handle_t *) handle; /* NULL = empty, ZR_REMOVED */
+} zr_entry_t;
+
+typedef struct {
+	unsigned int	size;	/* power of two */
+	unsigned int	used;	/* including ZR_REMOVED entries */
+	unsigned int	live;
+	zr_entry_t	entries[];
+} zr_table_t;
+
 struct zone_register {
 	isc_mem_t	*mctx;
-	isc_rwlock_t	rwlock;
+	isc_rwlock_t	rwlock;	/* protects rbt and writes to table */
 	dns_rbt_t	*rbt;
+	_Atomic(zr_table_t *) table;
+	atomic_uint_fast32_t phase;
+	zr_reader_t	readers[ZR_READERS];
 	settings_set_t	*global_settings;
 	ldap_instance_t *ldap_inst;
+	dn_cache_t	*dn_cache;
+	atomic_uint_fast32_t generation; /* incremented on each add/delete
+					    and (un)publication */
 };
 
-typedef struct {
-	dns_zone_t	*raw;
-	dns_zone_t	*secure;
-	char		*dn;
-	settings_set_t	*settings;
-	dns_db_t	*ldapdb;
-} zone_info_t;
-
-/* Callback for dns_rbt_create(). */
-static void delete_zone_info(void *arg1, void *arg2);
+static _Thread_local unsigned int zr_reader_id; /* 0 = not assigned yet */
+static atomic_uint_fast32_t zr_reader_next;
 
 /**
  * Zone specific settings from idnsZone object:
@@ -98,6 +142,195 @@ zr_get_mctx(zone_register_t *zr) {
 	return zr->mctx;
 }
 
+dn_cache_t *
+zr_get_dn_cache(zone_register_t *zr) {
+	REQUIRE(zr);
+
+	return zr->dn_cache;
+}
+
+/**
+ * Get number of changes done in the zone register. Caches of data derived
+ * from zone register content can use it to detect added or deleted zones
+ * and zones published in or removed from the view.
+ */
+unsigned int
+zr_get_generation(zone_register_t *zr) {
+	REQUIRE(zr);
+
+	return (unsigned int)atomic_load(&zr->generation);
+}
+
+/**
+ * Invalidate data derived from zone register content after a change
+ * which is not visible in the register itself, i.e. after a zone
+ * was published in or removed from the view.
+ */
+void
+zr_bump_generation(zone_register_t *zr) {
+	REQUIRE(zr);
+
+	atomic_fetch_add(&zr->generation, 1);
+}
+
+static zr_table_t * ATTR_NONNULLS ATTR_CHECKRESULT
+zr_table_create(isc_mem_t *mctx, unsigned int size)
+{
+	zr_table_t *table;
+	size_t len = sizeof(*table) + size * sizeof(table->entries[0]);
+
+	table = isc_mem_get(mctx, len);
+	memset(table, 0, len);
+	table->size = size;
+
+	return table;
+}
+
+static void ATTR_NONNULLS
+zr_table_free(isc_mem_t *mctx, zr_table_t **tablep)
+{
+	zr_table_t *table = *tablep;
+
+	isc_mem_put(mctx, table, sizeof(*table)
+		    + table->size * sizeof(table->entries[0]));
+	*tablep = NULL;
+}
+
+/**
+ * Store handle to an empty slot. Readers can see the new entry immediately.
+ *
+ * @pre Zone register is write-locked.
+ */
+static void ATTR_NONNULLS
+zr_table_insert(zr_table_t *table, zone_handle_t *handle, unsigned int hash)
+{
+	unsigned int mask = table->size - 1;
+	unsigned int i;
+
+	for (i = hash & mask;
+	     atomic_load_explicit(&table->entries[i].handle,
+				  memory_order_relaxed) != NULL;
+	     i = (i + 1) & mask)
+		;
+	table->entries[i].hash = hash;
+	atomic_store_explicit(&table->entries[i].handle, handle,
+			      memory_order_release);
+	table->used++;
+	table->live++;
+}
+
+/**
+ * @returns Slot with handle of zone with origin 'name' or NULL.
+ *          The handle is stored to 'handlep'.
+ *
+ * @pre Caller is zone register reader or holds the write lock.
+ */
+static zr_entry_t * ATTR_NONNULLS ATTR_CHECKRESULT
+zr_table_find(zr_table_t *table, const dns_name_t *name, unsigned int hash,
+	      zone_handle_t **handlep)
+{
+	unsigned int mask = table->size - 1;
+	unsigned int i;
+	zone_handle_t *handle;
+
+	/* Table is at most half full so the search always terminates. */
+	for (i = hash & mask; ; i = (i + 1) & mask) {
+		handle = atomic_load_explicit(&table->entries[i].handle,
+					      memory_order_acquire);
+		if (handle == NULL)
+			return NULL;
+		if (handle != ZR_REMOVED && table->entries[i].hash == hash &&
+		    dns_name_equal(dns_zone_getorigin(handle->raw), name)) {
+			*handlep = handle;
+			return &table->entries[i];
+		}
+	}
+}
+
+/**
+ * Start lock-free read of the zone register. Nothing is written to memory
+ * shared with other threads except the reader slot of the calling thread.
+ *
+ * @returns Phase which has to be passed to zr_read_end().
+ */
+static unsigned int ATTR_NONNULLS ATTR_CHECKRESULT
+zr_read_begin(zone_register_t *zr, zr_reader_t **readerp)
+{
+	unsigned int phase;
+
+	if (zr_reader_id == 0)
+		zr_reader_id = atomic_fetch_add(&zr_reader_next, 1) + 1;
+	*readerp = &zr->readers[zr_reader_id % ZR_READERS];
+
+	phase = atomic_load(&zr->phase) & 1;
+	atomic_fetch_add(&(*readerp)->active[phase], 1);
+
+	return phase;
+}
+
+static void ATTR_NONNULLS
+zr_read_end(zr_reader_t *reader, unsigned int phase)
+{
+	atomic_fetch_sub_explicit(&reader->active[phase], 1,
+				  memory_order_release);
+}
+
+/**
+ * Wait until all readers which started before the call leave
+ * their critical sections. Readers which start later cannot see
+ * entries removed or tables replaced before the call.
+ *
+ * Critical sections of readers are short and never block
+ * so the wait is short as well.
+ *
+ * @pre Zone register is write-locked.
+ */
+static void ATTR_NONNULLS
+zr_synchronize(zone_register_t *zr)
+{
+	unsigned int phase;
+	unsigned int i;
+
+	phase = atomic_fetch_xor(&zr->phase, 1) & 1;
+	for (i = 0; i < ZR_READERS; i++)
+		while (atomic_load(&zr->readers[i].active[phase]) != 0)
+			sched_yield();
+}
+
+/**
+ * Make sure that the table has room for one more entry and replace it
+ * with a bigger or cleaned up table if it does not.
+ *
+ * @pre Zone register is write-locked.
+ */
+static void ATTR_NONNULLS
+zr_table_reserve(zone_register_t *zr)
+{
+	zr_table_t *table = atomic_load(&zr->table);
+	zr_table_t *new_table;
+	zone_handle_t *handle;
+	unsigned int size;
+	unsigned int i;
+
+	if ((table->used + 1) * 2 <= table->size)
+		return;
+
+	for (size = ZR_TABLE_MIN; (table->live + 1) * 4 > size; size *= 2)
+		;
+	new_table = zr_table_create(zr->mctx, size);
+	for (i = 0; i < table->size; i++) {
+		handle = atomic_load_explicit(&table->entries[i].handle,
+					      memory_order_relaxed);
+		if (handle != NULL && handle != ZR_REMOVED)
+			zr_table_insert(new_table, handle,
+					table->entries[i].hash);
+	}
+
+	atomic_store(&zr->table, new_table);
+	zr_synchronize(zr);
+	zr_table_free(zr->mctx, &table);
+}
+
 /**
  * Create a new zone register.
  */
@@ -115,13 +348,16 @@ zr_create(isc_mem_t *mctx, ldap_instance_t *ldap_inst,
 	zr = isc_mem_get(mctx, sizeof(*(zr)));
 	ZERO_PTR(zr);
 	isc_mem_attach(mctx, &zr->mctx);
-	CHECK(dns_rbt_create(mctx, delete_zone_info, mctx, &zr->rbt));
+	/* Zone handles are released by zr_del_zone(). */
+	CHECK(dns_rbt_create(mctx, NULL, NULL, &zr->rbt));
 #if LIBDNS_VERSION_MAJOR >= 1600
 	/* Never fails on BIND 9.16, even it if returns value */
 	(void)isc_rwlock_init(&zr->rwlock, 0, 0);
 #else
 	CHECK(isc_rwlock_init(&zr->rwlock, 0, 0));
 #endif
+	CHECK(dn_cache_create(mctx, DN_CACHE_SIZE, &zr->dn_cache));
+	atomic_init(&zr->table, zr_table_create(mctx, ZR_TABLE_MIN));
 	zr->global_settings = glob_settings;
 	zr->ldap_inst = ldap_inst;
 
@@ -150,6 +386,7 @@ zr_destroy(zone_register_t **zrp)
 {
 	DECLARE_BUFFERED_NAME(name);
 	zone_register_t *zr;
+	zr_table_t *table;
 	rbt_iterator_t *iter = NULL;
 	isc_result_t result;
 
@@ -176,6 +413,9 @@ zr_destroy(zone_register_t **zrp)
 	dns_rbt_destroy(&zr->rbt);
 	RWUNLOCK(&zr->rwlock, isc_rwlocktype_write);
 	isc_rwlock_destroy(&zr->rwlock);
+	dn_cache_destroy(&zr->dn_cache);
+	table = atomic_load(&zr->table);
+	zr_table_free(zr->mctx, &table);
 	MEM_PUT_AND_DETACH(zr);
 
 	*zrp = NULL;
@@ -240,7 +480,7 @@ zr_get_zone_path(isc_mem_t *mctx, settings_set_t *settings,
 	isc_buffer_putuint8(&name_buf, '\0');
 	INSIST(isc_buffer_usedlength(&name_buf) >= 2);
 
-	CHECK(setting_get_str("directory", settings, &inst_dir));
+	CHECK(setting_get_str(SETTING_DIRECTORY, settings, &inst_dir));
 	CHECK(str_cat_char(zone_path, inst_dir));
 	CHECK(str_cat_char(zone_path, "master/"));
 	CHECK(str_cat_char(zone_path, isc_buffer_base(&name_buf)));
@@ -257,40 +497,99 @@ cleanup:
 	return result;
 }
 
+void
+zone_handle_attach(zone_handle_t *source, zone_handle_t **targetp)
+{
+	REQUIRE(targetp != NULL && *targetp == NULL);
+
+#if LIBDNS_VERSION_MAJOR < 1600
+	isc_refcount_increment(&source->refs, NULL);
+#else
+	isc_refcount_increment(&source->refs);
+#endif
+	*targetp = source;
+}
+
+/**
+ * Release reference to the zone handle. Zones, databases and settings
+ * are released with the last reference.
+ */
+void
+zone_handle_detach(zone_handle_t **handlep)
+{
+	zone_handle_t *handle;
+	unsigned int refs;
+
+	if (handlep == NULL || *handlep == NULL)
+		return;
+
+	handle = *handlep;
+	*handlep = NULL;
+
+#if LIBDNS_VERSION_MAJOR < 1600
+	isc_refcount_decrement(&handle->refs, &refs);
+#else
+	refs = isc_refcount_decrement(&handle->refs);
+#endif
+	if (refs != REFCOUNT_FLOOR)
+		return;
+
+	if (handle->dn != NULL)
+		isc_mem_free(handle->mctx, handle->dn);
+	settings_set_free(&handle->settings);
+	if (handle->raw != NULL)
+		dns_zone_detach(&handle->raw);
+	if (handle->secure != NULL)
+		dns_zone_detach(&handle->secure);
+	if (handle->ldapdb != NULL)
+		dns_db_detach(&handle->ldapdb);
+	if (handle->rbtdb != NULL)
+		dns_db_detach(&handle->rbtdb);
+	if (handle->task != NULL)
+		isc_task_detach(&handle->task);
+	isc_refcount_destroy(&handle->refs);
+	MEM_PUT_AND_DETACH(handle);
+}
+
 /**
- * Create a new zone info structure.
+ * Create a new zone handle.
  */
 #define PRINT_BUFF_SIZE 255
 static isc_result_t ATTR_NONNULL(1,2,4,5,6,8)
-create_zone_info(isc_mem_t * const mctx, dns_zone_t * const raw,
-		dns_zone_t * const secure, const char * const dn,
-		 settings_set_t *global_settings, ldap_instance_t *inst,
-		 dns_db_t * const ldapdb, zone_info_t **zinfop)
+create_zone_handle(isc_mem_t * const mctx, dns_zone_t * const raw,
+		   dns_zone_t * const secure, const char * const dn,
+		   settings_set_t *global_settings, ldap_instance_t *inst,
+		   dns_db_t * const ldapdb, zone_handle_t **handlep)
 {
 	isc_result_t result;
-	zone_info_t *zinfo;
+	zone_handle_t *handle;
 	char settings_name[PRINT_BUFF_SIZE];
 	ld_string_t *zone_dir = NULL;
 
 	REQUIRE(inst != NULL);
 	REQUIRE(raw != NULL);
 	REQUIRE(dn != NULL);
-	REQUIRE(zinfop != NULL && *zinfop == NULL);
-
-	zinfo = isc_mem_get(mctx, sizeof(*(zinfo)));
-	ZERO_PTR(zinfo);
-	zinfo->dn = isc_mem_strdup(mctx, dn);
-	dns_zone_attach(raw, &zinfo->raw);
+	REQUIRE(handlep != NULL && *handlep == NULL);
+
+	handle = isc_mem_get(mctx, sizeof(*handle));
+	ZERO_PTR(handle);
+	isc_mem_attach(mctx, &handle->mctx);
+	isc_refcount_init(&handle->refs, 1);
+	ISC_LINK_INIT(handle, publish_link);
+	ISC_LINK_INIT(handle, serial_link);
+	atomic_init(&handle->files_stale, false);
+	handle->dn = isc_mem_strdup(mctx, dn);
+	dns_zone_attach(raw, &handle->raw);
 	if (secure != NULL)
-		dns_zone_attach(secure, &zinfo->secure);
+		dns_zone_attach(secure, &handle->secure);
+	dns_zone_gettask(raw, &handle->task);
 
-	zinfo->settings = NULL;
 	/* truncation is allowed */
 	snprintf(settings_name, PRINT_BUFF_SIZE, SETTING_SET_NAME_ZONE " %s",
 		 dn);
 	CHECK(settings_set_create(mctx, zone_settings, sizeof(zone_settings),
 				  settings_name, global_settings,
-				  &zinfo->settings));
+				  &handle->settings));
 
 	/* Prepare a directory for this maybesecure */
 	CHECK(zr_get_zone_path(mctx, global_settings, dns_zone_getorigin(raw),
@@ -300,69 +599,44 @@ create_zone_info(isc_mem_t * const mctx, dns_zone_t * const raw,
 	if (ldapdb == NULL) { /* create new empty database */
 		CHECK(ldapdb_create(mctx, dns_zone_getorigin(raw),
 				    LDAP_DB_TYPE, LDAP_DB_RDATACLASS,
-				    inst, &zinfo->ldapdb));
+				    inst, &handle->ldapdb));
 	} else { /* re-use existing database */
-		dns_db_attach(ldapdb, &zinfo->ldapdb);
+		dns_db_attach(ldapdb, &handle->ldapdb);
 	}
+	dns_db_attach(ldapdb_get_rbtdb(handle->ldapdb), &handle->rbtdb);
 
 cleanup:
 	if (result == ISC_R_SUCCESS)
-		*zinfop = zinfo;
+		*handlep = handle;
 	else
-		delete_zone_info(zinfo, mctx);
+		zone_handle_detach(&handle);
 
 	str_destroy(&zone_dir);
 	return result;
 }
 
-/**
- * Delete a zone info structure. The two arguments are of type void * so the
- * function can be used as a node deleter for the red-black tree.
- */
-static void ATTR_NONNULL(2)
-delete_zone_info(void *arg1, void *arg2)
-{
-	zone_info_t *zinfo = arg1;
-	isc_mem_t *mctx = arg2;
-
-	if (zinfo == NULL)
-		return;
-
-	settings_set_free(&zinfo->settings);
-	if (zinfo->dn != NULL)
-		isc_mem_free(mctx, zinfo->dn);
-	if (zinfo->raw != NULL)
-		dns_zone_detach(&zinfo->raw);
-	if (zinfo->secure != NULL)
-		dns_zone_detach(&zinfo->secure);
-	if (zinfo->ldapdb != NULL)
-		dns_db_detach(&zinfo->ldapdb);
-	SAFE_MEM_PUT_PTR(mctx, zinfo);
-}
-
 /**
  * Find a zone in ZR with origin exactly matching 'name'.
  *
- * @pre Zone registed is locked.
+ * @pre Caller is zone register reader (see zr_read_begin())
+ *      or holds the write lock.
  */
 static isc_result_t
-getzinfo(zone_register_t * const zr, const dns_name_t *name,
-	 zone_info_t **zinfo)
+gethandle(zone_register_t * const zr, const dns_name_t *name,
+	  zone_handle_t **handlep)
 {
-	isc_result_t result;
-	void *data = NULL;
+	zone_handle_t *handle = NULL;
 
 	REQUIRE(zr != NULL);
 	REQUIRE(dns_name_isabsolute(name));
-	REQUIRE(zinfo != NULL && *zinfo == NULL);
+	REQUIRE(handlep != NULL && *handlep == NULL);
 
-	result = dns_rbt_findname(zr->rbt, name, 0, NULL, &data);
-	if (result == ISC_R_SUCCESS)
-		*zinfo = data;
-	else if (result == DNS_R_PARTIALMATCH)
-		result = ISC_R_NOTFOUND;
+	if (zr_table_find(atomic_load(&zr->table), name, name_hash(name),
+			  &handle) == NULL)
+		return ISC_R_NOTFOUND;
 
-	return result;
+	*handlep = handle;
+	return ISC_R_SUCCESS;
 }
 
 /**
@@ -376,8 +650,8 @@ zr_add_zone(zone_register_t * const zr, dns_db_t * const ldapdb,
 {
 	isc_result_t result;
 	dns_name_t *name;
-	zone_info_t *new_zinfo = NULL;
-	zone_info_t *dummy = NULL;
+	zone_handle_t *new_handle = NULL;
+	zone_handle_t *dummy = NULL;
 
 	REQUIRE(zr != NULL);
 	REQUIRE(raw != NULL);
@@ -391,7 +665,7 @@ zr_add_zone(zone_register_t * const zr, dns_db_t * const ldapdb,
 	 * First make sure the node doesn't exist. Partial matches mean
 	 * there are also child zones in the LDAP database which is allowed.
 	 */
-	result = getzinfo(zr, name, &dummy);
+	result = gethandle(zr, name, &dummy);
 	if (result != ISC_R_NOTFOUND) {
 		if (result == ISC_R_SUCCESS)
 			result = ISC_R_EXISTS;
@@ -399,17 +673,22 @@ zr_add_zone(zone_register_t * const zr, dns_db_t * const ldapdb,
 		goto cleanup;
 	}
 
-	CHECK(create_zone_info(zr->mctx, raw, secure, dn, zr->global_settings,
-			       zr->ldap_inst, ldapdb, &new_zinfo));
-	CHECK(dns_rbt_addname(zr->rbt, name, new_zinfo));
+	CHECK(create_zone_handle(zr->mctx, raw, secure, dn,
+				 zr->global_settings, zr->ldap_inst, ldapdb,
+				 &new_handle));
+	CHECK(dns_rbt_addname(zr->rbt, name, new_handle));
+	/* Readers can see the zone from now on. */
+	zr_table_reserve(zr);
+	zr_table_insert(atomic_load(&zr->table), new_handle,
+			name_hash(name));
+	new_handle = NULL;
+	dn_cache_flush_zone(zr->dn_cache, name);
+	atomic_fetch_add(&zr->generation, 1);
 
 cleanup:
 	RWUNLOCK(&zr->rwlock, isc_rwlocktype_write);
 
-	if (result != ISC_R_SUCCESS) {
-		if (new_zinfo != NULL)
-			delete_zone_info(new_zinfo, zr->mctx);
-	}
+	zone_handle_detach(&new_handle);
 
 	return result;
 }
@@ -418,14 +697,31 @@ isc_result_t
 zr_del_zone(zone_register_t *zr, dns_name_t *origin)
 {
 	isc_result_t result;
+	zr_table_t *table;
+	zr_entry_t *entry;
+	zone_handle_t *handle = NULL;
 
 	REQUIRE(zr != NULL);
 	REQUIRE(origin != NULL);
 
 	RWLOCK(&zr->rwlock, isc_rwlocktype_write);
 
+	dn_cache_flush_zone(zr->dn_cache, origin);
+	atomic_fetch_add(&zr->generation, 1);
+	table = atomic_load(&zr->table);
+	entry = zr_table_find(table, origin, name_hash(origin), &handle);
+	if (entry == NULL)
+		CLEANUP_WITH(ISC_R_NOTFOUND);
 	CHECK(dns_rbt_deletename(zr->rbt, origin, false));
 
+	/* Events holding the handle must not touch the zone. */
+	handle->removed = true;
+	atomic_store(&entry->handle, ZR_REMOVED);
+	table->live--;
+	/* Release the handle only when no reader can use it. */
+	zr_synchronize(zr);
+	zone_handle_detach(&handle);
+
 cleanup:
 	RWUNLOCK(&zr->rwlock, isc_rwlocktype_write);
 
@@ -449,27 +745,25 @@ zr_get_zone_dbs(zone_register_t *zr, const dns_name_t *name,
 		dns_db_t **ldapdbp, dns_db_t **rbtdbp)
 {
 	isc_result_t result;
-	zone_info_t *zinfo = NULL;
-	dns_db_t *ldapdb = NULL;
+	zone_handle_t *handle = NULL;
+	zr_reader_t *reader;
+	unsigned int phase;
 
 	REQUIRE(zr != NULL);
 	REQUIRE(name != NULL);
 	REQUIRE(ldapdbp != NULL || rbtdbp != NULL);
 
-	RWLOCK(&zr->rwlock, isc_rwlocktype_read);
+	phase = zr_read_begin(zr, &reader);
 
-	CHECK(getzinfo(zr, name, &zinfo));
-	dns_db_attach(zinfo->ldapdb, &ldapdb);
-	if (ldapdbp != NULL)
-		dns_db_attach(ldapdb, ldapdbp);
-	if (rbtdbp != NULL)
-		dns_db_attach(ldapdb_get_rbtdb(ldapdb), rbtdbp);
-
-cleanup:
-	RWUNLOCK(&zr->rwlock, isc_rwlocktype_read);
+	result = gethandle(zr, name, &handle);
+	if (result == ISC_R_SUCCESS) {
+		if (ldapdbp != NULL)
+			dns_db_attach(handle->ldapdb, ldapdbp);
+		if (rbtdbp != NULL)
+			dns_db_attach(handle->rbtdb, rbtdbp);
+	}
 
-	if (ldapdb != NULL)
-		dns_db_detach(&ldapdb);
+	zr_read_end(reader, phase);
 
 	return result;
 }
@@ -484,19 +778,21 @@ isc_result_t
 zr_get_zone_dn(zone_register_t *zr, dns_name_t *name, const char **dn)
 {
 	isc_result_t result;
-	zone_info_t *zinfo = NULL;
+	zone_handle_t *handle = NULL;
+	zr_reader_t *reader;
+	unsigned int phase;
 
 	REQUIRE(zr != NULL);
 	REQUIRE(name != NULL);
 	REQUIRE(dn != NULL && *dn == NULL);
 
-	RWLOCK(&zr->rwlock, isc_rwlocktype_read);
+	phase = zr_read_begin(zr, &reader);
 
-	result = getzinfo(zr, name, &zinfo);
+	result = gethandle(zr, name, &handle);
 	if (result == ISC_R_SUCCESS)
-		*dn = zinfo->dn;
+		*dn = handle->dn;
 
-	RWUNLOCK(&zr->rwlock, isc_rwlocktype_read);
+	zr_read_end(reader, phase);
 
 	return result;
 }
@@ -517,7 +813,9 @@ zr_get_zone_ptr(zone_register_t * const zr, dns_name_t * const name,
 		dns_zone_t ** const rawp, dns_zone_t ** const securep)
 {
 	isc_result_t result;
-	zone_info_t *zinfo = NULL;
+	zone_handle_t *handle = NULL;
+	zr_reader_t *reader;
+	unsigned int phase;
 
 	REQUIRE(zr != NULL);
 	REQUIRE(name != NULL);
@@ -525,17 +823,17 @@ zr_get_zone_ptr(zone_register_t * const zr, dns_name_t * const name,
 	REQUIRE(rawp == NULL || *rawp == NULL);
 	REQUIRE(securep == NULL || *securep == NULL);
 
-	RWLOCK(&zr->rwlock, isc_rwlocktype_read);
+	phase = zr_read_begin(zr, &reader);
 
-	result = getzinfo(zr, name, &zinfo);
+	result = gethandle(zr, name, &handle);
 	if (result == ISC_R_SUCCESS) {
 		if (rawp != NULL)
-			dns_zone_attach(zinfo->raw, rawp);
-		if (zinfo->secure != NULL && securep != NULL)
-			dns_zone_attach(zinfo->secure, securep);
+			dns_zone_attach(handle->raw, rawp);
+		if (handle->secure != NULL && securep != NULL)
+			dns_zone_attach(handle->secure, securep);
 	}
 
-	RWUNLOCK(&zr->rwlock, isc_rwlocktype_read);
+	zr_read_end(reader, phase);
 
 	return result;
 }
@@ -550,19 +848,52 @@ zr_get_zone_settings(zone_register_t *zr, const dns_name_t *name,
 	             settings_set_t **set)
 {
 	isc_result_t result;
-	zone_info_t *zinfo = NULL;
+	zone_handle_t *handle = NULL;
+	zr_reader_t *reader;
+	unsigned int phase;
 
 	REQUIRE(zr != NULL);
 	REQUIRE(name != NULL);
 	REQUIRE(set != NULL && *set == NULL);
 
-	RWLOCK(&zr->rwlock, isc_rwlocktype_read);
+	phase = zr_read_begin(zr, &reader);
+
+	result = gethandle(zr, name, &handle);
+	if (result == ISC_R_SUCCESS)
+		*set = handle->settings;
+
+	zr_read_end(reader, phase);
+
+	return result;
+}
+
+/**
+ * Find a zone with origin 'name' within in the zone register 'zr' and
+ * attach its handle. The handle provides zones, databases, settings
+ * and task of the zone without further zone register lookups.
+ *
+ * @remark Caller has to detach the handle using zone_handle_detach().
+ */
+isc_result_t
+zr_get_zone_handle(zone_register_t *zr, const dns_name_t *name,
+		   zone_handle_t **handlep)
+{
+	isc_result_t result;
+	zone_handle_t *handle = NULL;
+	zr_reader_t *reader;
+	unsigned int phase;
+
+	REQUIRE(zr != NULL);
+	REQUIRE(name != NULL);
+	REQUIRE(handlep != NULL && *handlep == NULL);
+
+	phase = zr_read_begin(zr, &reader);
 
-	result = getzinfo(zr, name, &zinfo);
+	result = gethandle(zr, name, &handle);
 	if (result == ISC_R_SUCCESS)
-		*set = zinfo->settings;
+		zone_handle_attach(handle, handlep);
 
-	RWUNLOCK(&zr->rwlock, isc_rwlocktype_read);
+	zr_read_end(reader, phase);
 
 	return result;
 }
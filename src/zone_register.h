@@ -5,13 +5,48 @@
 #ifndef _LD_ZONE_REGISTER_H_
 #define _LD_ZONE_REGISTER_H_
 
+#include <isc/list.h>
+#include <isc/refcount.h>
 #include <isc/rwlock.h>
 #include <dns/zt.h>
 
+#include <stdatomic.h>
+
+#include "dn_cache.h"
 #include "settings.h"
 #include "rbt_helper.h"
 #include "ldap_helper.h"
 
+/**
+ * Zone from zone register with everything needed to apply a change to it.
+ * Zone register holds one reference until the zone is removed, users
+ * hold their own references. Fields do not change during lifetime
+ * of the handle.
+ */
+struct zone_handle {
+	isc_mem_t	*mctx;
+	isc_refcount_t	refs;
+	char		*dn;
+	dns_zone_t	*raw;
+	dns_zone_t	*secure;	/* NULL if zone is not signed inline */
+	dns_db_t	*ldapdb;
+	dns_db_t	*rbtdb;
+	settings_set_t	*settings;
+	isc_task_t	*task;		/* task of the raw zone */
+	/* Zone was removed from zone register, set by zr_del_zone(). */
+	bool		removed;
+	/* Files of the zone have to be removed before the zone is
+	 * written, see cleanup_files() in ldap_helper.c. */
+	atomic_bool	files_stale;
+	/* Zone is waiting for publication in the view, protected by
+	 * publish lock of the instance, see publish_zone_defer(). */
+	ISC_LINK(zone_handle_t)	publish_link;
+	/* SOA serial waiting for write back to LDAP, protected by serial
+	 * lock of the instance, see ldap_serial_writeback(). */
+	uint32_t		serial;
+	ISC_LINK(zone_handle_t)	serial_link;
+};
+
 isc_result_t
 zr_create(isc_mem_t *mctx, ldap_instance_t *ldap_inst,
 	  settings_set_t *glob_settings, zone_register_t **zrp) ATTR_NONNULLS;
@@ -43,6 +78,16 @@ zr_get_zone_ptr(zone_register_t * const zr, dns_name_t * const name,
 isc_result_t
 zr_get_zone_settings(zone_register_t *zr, const dns_name_t *name, settings_set_t **set) ATTR_NONNULLS ATTR_CHECKRESULT;
 
+isc_result_t
+zr_get_zone_handle(zone_register_t *zr, const dns_name_t *name,
+		   zone_handle_t **handlep) ATTR_NONNULLS ATTR_CHECKRESULT;
+
+void
+zone_handle_attach(zone_handle_t *source, zone_handle_t **targetp) ATTR_NONNULLS;
+
+void
+zone_handle_detach(zone_handle_t **handlep) ATTR_NONNULLS;
+
 isc_result_t
 zr_get_zone_path(isc_mem_t *mctx, settings_set_t *settings,
 		 dns_name_t *zone_name, const char *last_component,
@@ -55,6 +100,15 @@ zr_rbt_iter_init(zone_register_t *zr, rbt_iterator_t **iter,
 isc_mem_t *
 zr_get_mctx(zone_register_t *zr) ATTR_NONNULLS ATTR_CHECKRESULT;
 
+dn_cache_t *
+zr_get_dn_cache(zone_register_t *zr) ATTR_NONNULLS ATTR_CHECKRESULT;
+
+unsigned int
+zr_get_generation(zone_register_t *zr) ATTR_NONNULLS ATTR_CHECKRESULT;
+
+void
+zr_bump_generation(zone_register_t *zr) ATTR_NONNULLS;
+
 isc_result_t
 delete_bind_zone(dns_zt_t *zt, dns_zone_t **zonep) ATTR_NONNULLS ATTR_CHECKRESULT;
 